@@ -0,0 +1,380 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "batch.h"
+#include "engine.h"
+
+#define LINE_LENGTH 256
+#define READ_BUFFER 65536
+
+typedef struct batch_job
+{
+    int date[3];
+    double cost;
+    bool done;
+    uint64_t solutions;
+    bool complete;
+} batch_job;
+
+// Up to BATCH_WINDOW consecutive lines, their dates solved once each and longest first
+typedef struct batch_chunk
+{
+    uint32_t first_line; // Input line of its first line, counted from 0
+    uint32_t line_count;
+    int lines[BATCH_WINDOW]; // Job of each line, -1 for lines which aren't a valid date
+
+    batch_job jobs[BATCH_WINDOW];
+    int job_count;
+    int order[BATCH_WINDOW]; // Jobs by decreasing cost
+    int next_order;          // Jobs before it in order are started
+} batch_chunk;
+
+// The input read with read() rather than stdio, so that it can tell whether more lines are ready
+typedef struct line_reader
+{
+    int fd;
+    char buffer[READ_BUFFER];
+    size_t start, length;
+    bool eof;
+} line_reader;
+
+typedef struct batch
+{
+    const puzzle_tables *tables;
+    cache *results;
+    uint64_t limit;
+
+    // Ring of the chunks read, from the one being printed to the last one published. Past
+    // BATCH_CHUNKS of them the reader waits for the output.
+    batch_chunk *chunks;
+    uint32_t chunk_start, chunk_end;
+    bool eof; // Every chunk is published
+
+    line_reader reader;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} batch;
+
+//-------------------------Input-------------------------
+
+static bool buffered_line(const line_reader *r, size_t *length)
+{
+    // A line as fgets would read it : up to its newline, LINE_LENGTH - 1 characters or the end of
+    // the input
+    size_t available = r->length - r->start;
+    size_t limit = available < LINE_LENGTH - 1 ? available : LINE_LENGTH - 1;
+    const char *end = (const char *)memchr(r->buffer + r->start, '\n', limit);
+    if (end != NULL)
+        *length = end - (r->buffer + r->start) + 1;
+    else if (available >= LINE_LENGTH - 1 || (r->eof && available > 0))
+        *length = limit;
+    else
+        return false;
+    return true;
+}
+
+// The next line into line, false at the end of the input
+static bool next_line(line_reader *r, char *line)
+{
+    size_t length;
+    while (!buffered_line(r, &length))
+    {
+        if (r->eof)
+            return false;
+        memmove(r->buffer, r->buffer + r->start, r->length - r->start);
+        r->length -= r->start;
+        r->start = 0;
+
+        ssize_t n = read(r->fd, r->buffer + r->length, READ_BUFFER - r->length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            r->eof = true;
+        else
+            r->length += n;
+    }
+
+    memcpy(line, r->buffer + r->start, length);
+    line[length] = '\0';
+    r->start += length;
+    return true;
+}
+
+// Whether the next line can be read without waiting for the input
+static bool line_ready(const line_reader *r)
+{
+    size_t length;
+    if (r->eof || buffered_line(r, &length))
+        return true;
+    struct pollfd input = {r->fd, POLLIN, 0};
+    return poll(&input, 1, 0) > 0;
+}
+
+static int find_job(batch_chunk *chunk, int *index, const int *date)
+{
+    // Open addressing on the date, index has twice as many slots as there can be jobs
+    uint32_t slots = 2 * BATCH_WINDOW;
+    uint32_t h = (uint32_t)(date[0] * 1031 + date[1] * 37 + date[2]) % slots;
+    while (index[h] >= 0)
+    {
+        batch_job *job = chunk->jobs + index[h];
+        if (memcmp(job->date, date, sizeof(job->date)) == 0)
+            return index[h];
+        h = (h + 1) % slots;
+    }
+
+    index[h] = chunk->job_count;
+    batch_job *job = chunk->jobs + chunk->job_count;
+    memset(job, 0, sizeof(batch_job));
+    memcpy(job->date, date, sizeof(job->date));
+    return chunk->job_count++;
+}
+
+static const batch_chunk *sorted_chunk;
+
+static int compare_costs(const void *a, const void *b)
+{
+    double first = sorted_chunk->jobs[*(const int *)a].cost, second = sorted_chunk->jobs[*(const int *)b].cost;
+    return first > second ? -1 : first < second;
+}
+
+static void *batch_reader(void *data)
+{
+    batch *b = (batch *)data;
+    char line[LINE_LENGTH];
+    int index[2 * BATCH_WINDOW];
+    uint32_t line_number = 0;
+
+    bool more = true;
+    while (more)
+    {
+        // A free slot, once the output has caught up
+        pthread_mutex_lock(&b->lock);
+        while (b->chunk_end - b->chunk_start == BATCH_CHUNKS)
+            pthread_cond_wait(&b->cond, &b->lock);
+        batch_chunk *chunk = b->chunks + b->chunk_end % BATCH_CHUNKS;
+        pthread_mutex_unlock(&b->lock);
+
+        chunk->first_line = line_number;
+        chunk->line_count = 0;
+        chunk->job_count = 0;
+        chunk->next_order = 0;
+        memset(index, -1, sizeof(index));
+
+        // The chunk is published full, at the end of the input, or as soon as the input pauses so
+        // that a pipe kept open gets its answers
+        while (chunk->line_count < BATCH_WINDOW && (chunk->line_count == 0 || line_ready(&b->reader)))
+        {
+            if (!(more = next_line(&b->reader, line)))
+                break;
+            if (line[strspn(line, " \t\r\n")] == '\0' || line[0] == '#')
+                continue;
+
+            // Separators may be spaces, commas or semicolons
+            for (char *c = line; *c != '\0'; c++)
+                if (*c == ',' || *c == ';')
+                    *c = ' ';
+
+            int date[3];
+            uint64_t board;
+            bool valid = sscanf(line, "%d %d %d", date, date + 1, date + 2) == 3 && tables_date_board(b->tables, date, &board);
+            chunk->lines[chunk->line_count++] = valid ? find_job(chunk, index, date) : -1;
+        }
+        line_number += chunk->line_count;
+
+        for (int i = 0; i < chunk->job_count; i++)
+        {
+            uint64_t board;
+            tables_date_board(b->tables, chunk->jobs[i].date, &board);
+            chunk->jobs[i].cost = engine_fitting_cost(b->tables, board);
+            chunk->order[i] = i;
+        }
+        sorted_chunk = chunk;
+        qsort(chunk->order, chunk->job_count, sizeof(int), compare_costs);
+
+        pthread_mutex_lock(&b->lock);
+        if (chunk->line_count > 0)
+            b->chunk_end++;
+        b->eof = !more;
+        pthread_cond_broadcast(&b->cond);
+        pthread_mutex_unlock(&b->lock);
+    }
+
+    return NULL;
+}
+
+//-------------------------Scheduling-------------------------
+
+static batch_job *next_job(batch *b)
+{
+    // Longest first in the oldest chunk which has dates left
+    for (uint32_t c = b->chunk_start; c < b->chunk_end; c++)
+    {
+        batch_chunk *chunk = b->chunks + c % BATCH_CHUNKS;
+        if (chunk->next_order < chunk->job_count)
+            return chunk->jobs + chunk->order[chunk->next_order++];
+    }
+    return NULL;
+}
+
+static void solve_job(batch *b, batch_job *job)
+{
+    const int *date = job->date;
+    uint64_t count;
+
+    pthread_mutex_lock(&b->lock);
+    bool cached = cache_get_count(b->results, date[0], date[1], date[2], &count);
+    pthread_mutex_unlock(&b->lock);
+
+    if (cached)
+    {
+        job->solutions = b->limit && count > b->limit ? b->limit : count;
+        job->complete = !b->limit || count <= b->limit;
+        return;
+    }
+
+    uint64_t board;
+    tables_date_board(b->tables, date, &board);
+
+    search_result result = {0, 0, false, false, 0};
+    if (tables_free_cells(b->tables, board) == tables_pieces_area(b->tables))
+    {
+        search_options options;
+        search_options_init(&options);
+        options.limit = b->limit;
+        result = engine_search(b->tables, board, &options);
+    }
+
+    job->solutions = result.solutions;
+    job->complete = !result.stopped;
+
+    pthread_mutex_lock(&b->lock);
+    if (job->complete)
+        cache_put_count(b->results, date[0], date[1], date[2], job->solutions);
+    else if (job->solutions > 0)
+        cache_put_exists(b->results, date[0], date[1], date[2], true);
+    pthread_mutex_unlock(&b->lock);
+}
+
+static void *batch_worker(void *data)
+{
+    batch *b = (batch *)data;
+
+    pthread_mutex_lock(&b->lock);
+    while (true)
+    {
+        batch_job *job;
+        while ((job = next_job(b)) == NULL && !b->eof)
+            pthread_cond_wait(&b->cond, &b->lock);
+        if (job == NULL)
+            break;
+
+        pthread_mutex_unlock(&b->lock);
+
+        solve_job(b, job);
+
+        pthread_mutex_lock(&b->lock);
+        job->done = true;
+        pthread_cond_broadcast(&b->cond);
+    }
+    pthread_mutex_unlock(&b->lock);
+
+    return NULL;
+}
+
+//-------------------------Output-------------------------
+
+static void print_record(const batch_chunk *chunk, FILE *out, const uint32_t line)
+{
+    int index = chunk->lines[line];
+    uint32_t number = chunk->first_line + line + 1;
+    if (index < 0)
+    {
+        fprintf(out, "{\"line\":%u,\"error\":\"invalid date\"}\n", number);
+        return;
+    }
+
+    const batch_job *job = chunk->jobs + index;
+    fprintf(out, "{\"line\":%u,\"month\":%d,\"day\":%d,\"week_day\":%d,\"solutions\":%llu,\"complete\":%s}\n",
+            number, job->date[0], job->date[1], job->date[2], (unsigned long long)job->solutions, job->complete ? "true" : "false");
+}
+
+int run_batch(const puzzle_tables *tables, cache *results, FILE *in, FILE *out, const int jobs, const uint64_t limit)
+{
+    batch *b = (batch *)calloc(1, sizeof(batch));
+    if (b != NULL)
+        b->chunks = (batch_chunk *)malloc(sizeof(batch_chunk) * BATCH_CHUNKS);
+    if (b == NULL || b->chunks == NULL)
+    {
+        fprintf(stderr, "Error : cannot allocate the batch\n");
+        free(b);
+        return 1;
+    }
+    b->tables = tables;
+    b->results = results;
+    b->limit = limit;
+    b->reader.fd = fileno(in);
+
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->cond, NULL);
+
+    pthread_t reader;
+    pthread_create(&reader, NULL, batch_reader, b);
+    int threads_count = jobs > 1 ? jobs : 1;
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * threads_count);
+    for (int i = 0; i < threads_count; i++)
+        pthread_create(threads + i, NULL, batch_worker, b);
+
+    // Records are streamed in input order as soon as the line's date is solved, a chunk is given
+    // back to the reader once printed
+    pthread_mutex_lock(&b->lock);
+    while (true)
+    {
+        if (b->chunk_start == b->chunk_end && !b->eof)
+        {
+            fflush(out);
+            while (b->chunk_start == b->chunk_end && !b->eof)
+                pthread_cond_wait(&b->cond, &b->lock);
+        }
+        if (b->chunk_start == b->chunk_end)
+            break;
+
+        const batch_chunk *chunk = b->chunks + b->chunk_start % BATCH_CHUNKS;
+        for (uint32_t line = 0; line < chunk->line_count; line++)
+        {
+            int index = chunk->lines[line];
+            if (index >= 0 && !chunk->jobs[index].done)
+            {
+                fflush(out);
+                while (!chunk->jobs[index].done)
+                    pthread_cond_wait(&b->cond, &b->lock);
+            }
+            print_record(chunk, out, line);
+        }
+
+        b->chunk_start++;
+        pthread_cond_broadcast(&b->cond);
+    }
+    pthread_mutex_unlock(&b->lock);
+    fflush(out);
+
+    pthread_join(reader, NULL);
+    for (int i = 0; i < threads_count; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    pthread_cond_destroy(&b->cond);
+    pthread_mutex_destroy(&b->lock);
+    free(b->chunks);
+    free(b);
+
+    return 0;
+}
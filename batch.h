@@ -0,0 +1,19 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "tables.h"
+#include "cache.h"
+
+// Lines read, deduplicated and scheduled together, and chunks of them read ahead of the output
+#define BATCH_WINDOW 1024
+#define BATCH_CHUNKS 3
+
+// Reads "month day week_day" lines from in and writes one JSON record per line to out, in
+// input order, as the lines arrive. Repeated dates of a chunk are solved once and its most
+// expensive ones are started first. With a limit, counting stops after that many solutions.
+int run_batch(const puzzle_tables *tables, cache *results, FILE *in, FILE *out, const int jobs, const uint64_t limit);
+
+#endif
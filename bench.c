@@ -0,0 +1,464 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "tables.h"
+#include "engine.h"
+#include "mitm.h"
+#include "frontier.h"
+#include "filters.h"
+#include "output.h"
+
+#define MAX_ENGINES 8
+
+// Solutions kept from a date for the output benchmark, then written over and over
+#define OUTPUT_SAMPLE 4096
+#define OUTPUT_SOLUTIONS 200000
+
+typedef enum engine_kind
+{
+    ENGINE_DFS,
+    ENGINE_DFS_PIECE,
+    ENGINE_DFS_CELL,
+    ENGINE_MITM,
+    ENGINE_FRONTIER
+} engine_kind;
+
+static const char *engine_names[] = {"dfs", "dfs-piece", "dfs-cell", "mitm", "frontier"};
+
+// Hardware counters read around every solve, the ones the kernel refuses are left out
+#define COUNTERS 5
+static const char *counter_names[] = {"cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"};
+
+typedef struct counter_set
+{
+    int fds[COUNTERS]; // -1 for an unavailable counter
+    int available;
+} counter_set;
+
+typedef struct engine_totals
+{
+    engine_kind kind;
+    double seconds, slowest;
+    uint64_t nodes;
+    uint64_t checks, parity_hits, size_hits;
+    double counts[COUNTERS];
+} engine_totals;
+
+// Command line
+void usage();
+int parse_engines(char *list, engine_totals *engines);
+
+// Timing
+double now();
+search_result run_engine(const engine_kind kind, const puzzle_tables *tables, const uint64_t board, filter_set *filters);
+
+// Hardware counters
+void counters_open(counter_set *counters);
+void counters_start(const counter_set *counters);
+void counters_stop(const counter_set *counters, double *counts);
+void counters_close(counter_set *counters);
+
+// Output
+void bench_output(const puzzle_tables *tables, const uint64_t board, const uint64_t count);
+double write_stdio(FILE *fp, const puzzle_tables *tables, const uint16_t *solutions, const uint32_t sample, const uint64_t count);
+
+void usage()
+{
+    fprintf(stderr, "Usage: ./bench [-p puzzle] [-e dfs,dfs-piece,dfs-cell,mitm,frontier] [-f parity,sizes|all|none] [-n N]\n"
+                    "  -e  engines to compare, the first one is the reference (default dfs,frontier),\n"
+                    "      dfs-piece and dfs-cell are the depth-first search with dynamic orders\n"
+                    "  -f  feasibility filters of the mitm and frontier engines (default all)\n"
+                    "  -n  only run every N-th date of the year\n"
+                    "  -c  timing only, without the hardware counters\n"
+                    "  -w  solutions written by the output benchmark in every format, 0 to skip it (default 200000)\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *puzzle_path = NULL;
+    char default_engines[] = "dfs,frontier";
+    char *engine_list = default_engines;
+    int every = 1;
+    bool parity = true, sizes = true;
+    bool use_counters = true;
+    uint64_t output_count = OUTPUT_SOLUTIONS;
+
+    int option;
+    while ((option = getopt(argc, argv, "p:e:f:n:cw:")) != -1)
+    {
+        switch (option)
+        {
+        case 'p':
+            puzzle_path = optarg;
+            break;
+        case 'e':
+            engine_list = optarg;
+            break;
+        case 'f':
+            if (!filters_parse(optarg, &parity, &sizes))
+                usage();
+            break;
+        case 'n':
+            every = atoi(optarg) > 0 ? atoi(optarg) : 1;
+            break;
+        case 'c':
+            use_counters = false;
+            break;
+        case 'w':
+            output_count = strtoull(optarg, NULL, 10);
+            break;
+        default:
+            usage();
+        }
+    }
+
+    engine_totals engines[MAX_ENGINES];
+    int engine_count = parse_engines(engine_list, engines);
+    if (engine_count == 0)
+        usage();
+
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    if (!tables_check_dates(tables))
+        exit(1);
+
+    filter_set filters;
+    if (!filters_init(&filters, tables, parity, sizes))
+        exit(1);
+    filter_set *active = parity || sizes ? &filters : NULL;
+
+    counter_set counters;
+    counters.available = 0;
+    if (use_counters)
+        counters_open(&counters);
+
+    // Same dates as ./days, one line per date with the count and the time of every engine, then
+    // its counters per node
+    printf("month;day;week_day;solutions");
+    for (int e = 0; e < engine_count; e++)
+    {
+        printf(";%s_seconds;%s_nodes", engine_names[engines[e].kind], engine_names[engines[e].kind]);
+        for (int c = 0; c < COUNTERS && counters.available; c++)
+            if (counters.fds[c] >= 0)
+                printf(";%s_%s_per_node", engine_names[engines[e].kind], counter_names[c]);
+    }
+    printf("\n");
+
+    int dates = 0, mismatches = 0, index = 0;
+    uint64_t output_board = 0;
+    for (int i = 0; i < tables_date_range(tables, 0); i++)
+        for (int j = 0; j < tables_date_range(tables, 1); j++)
+            for (int k = 0; k < tables_date_range(tables, 2); k++, index++)
+            {
+                if (index % every != 0)
+                    continue;
+
+                int targets[3] = {i, j, k};
+                uint64_t board;
+                tables_date_board(tables, targets, &board);
+                if (tables_free_cells(tables, board) != tables_pieces_area(tables))
+                    continue;
+
+                uint64_t reference = 0;
+                double seconds[MAX_ENGINES];
+                uint64_t nodes[MAX_ENGINES];
+                double counts[MAX_ENGINES][COUNTERS];
+                for (int e = 0; e < engine_count; e++)
+                {
+                    // The filters' counters are kept apart for every engine
+                    filters.checks = filters.parity_hits = filters.size_hits = 0;
+                    counters_start(&counters);
+                    double start = now();
+                    search_result result = run_engine(engines[e].kind, tables, board, active);
+                    seconds[e] = now() - start;
+                    counters_stop(&counters, counts[e]);
+                    nodes[e] = result.nodes;
+                    for (int c = 0; c < COUNTERS; c++)
+                        engines[e].counts[c] += counts[e][c];
+                    engines[e].checks += filters.checks;
+                    engines[e].parity_hits += filters.parity_hits;
+                    engines[e].size_hits += filters.size_hits;
+
+                    engines[e].seconds += seconds[e];
+                    engines[e].nodes += result.nodes;
+                    if (seconds[e] > engines[e].slowest)
+                        engines[e].slowest = seconds[e];
+
+                    if (e == 0)
+                        reference = result.solutions;
+                    else if (result.solutions != reference)
+                    {
+                        fprintf(stderr, "Error : %s finds %llu solutions for %d %d %d, %s finds %llu\n", engine_names[engines[e].kind], (unsigned long long)result.solutions,
+                                i, j, k, engine_names[engines[0].kind], (unsigned long long)reference);
+                        mismatches++;
+                    }
+                }
+
+                if (output_board == 0 && reference > 0)
+                    output_board = board;
+
+                printf("%d;%d;%d;%llu", i, j, k, (unsigned long long)reference);
+                for (int e = 0; e < engine_count; e++)
+                {
+                    printf(";%f;%llu", seconds[e], (unsigned long long)nodes[e]);
+                    for (int c = 0; c < COUNTERS && counters.available; c++)
+                        if (counters.fds[c] >= 0)
+                            printf(";%.2f", nodes[e] ? counts[e][c] / nodes[e] : 0);
+                }
+                printf("\n");
+                fflush(stdout);
+                dates++;
+            }
+
+    fprintf(stderr, "%d dates, %d mismatches\n", dates, mismatches);
+    for (int e = 0; e < engine_count; e++)
+        fprintf(stderr, "%-9s total %10.3f s  mean %8.4f s  slowest %8.4f s  nodes %llu (%.4f of %s)\n", engine_names[engines[e].kind], engines[e].seconds,
+                dates ? engines[e].seconds / dates : 0, engines[e].slowest, (unsigned long long)engines[e].nodes,
+                engines[0].nodes ? (double)engines[e].nodes / engines[0].nodes : 0, engine_names[engines[0].kind]);
+    for (int e = 0; e < engine_count && counters.available; e++)
+    {
+        fprintf(stderr, "%-9s per node :", engine_names[engines[e].kind]);
+        for (int c = 0; c < COUNTERS; c++)
+            if (counters.fds[c] >= 0)
+                fprintf(stderr, " %s %.2f", counter_names[c], engines[e].nodes ? engines[e].counts[c] / engines[e].nodes : 0);
+        if (counters.fds[0] >= 0 && counters.fds[1] >= 0 && engines[e].counts[0] > 0)
+            fprintf(stderr, ", %.2f instructions per cycle", engines[e].counts[1] / engines[e].counts[0]);
+        fprintf(stderr, "\n");
+    }
+    if (active != NULL)
+        for (int e = 0; e < engine_count; e++)
+            if (engines[e].checks > 0)
+                fprintf(stderr, "%-9s filter checks %llu, cut by parity %llu, cut by sizes %llu\n", engine_names[engines[e].kind], (unsigned long long)engines[e].checks,
+                        (unsigned long long)engines[e].parity_hits, (unsigned long long)engines[e].size_hits);
+
+    if (output_count > 0 && output_board != 0)
+        bench_output(tables, output_board, output_count);
+
+    counters_close(&counters);
+    filters_free(&filters);
+    tables_free(tables);
+    return mismatches != 0;
+}
+
+int parse_engines(char *list, engine_totals *engines)
+{
+    int count = 0;
+    for (char *name = strtok(list, ","); name != NULL && count < MAX_ENGINES; name = strtok(NULL, ","))
+    {
+        int kind = -1;
+        for (int i = 0; i < (int)(sizeof(engine_names) / sizeof(engine_names[0])); i++)
+            if (strcmp(name, engine_names[i]) == 0)
+                kind = i;
+        if (kind < 0)
+        {
+            fprintf(stderr, "Error : unknown engine %s\n", name);
+            return 0;
+        }
+
+        memset(engines + count, 0, sizeof(engine_totals));
+        engines[count++].kind = (engine_kind)kind;
+    }
+    return count;
+}
+
+//-------------------------Timing-------------------------
+
+double now()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+search_result run_engine(const engine_kind kind, const puzzle_tables *tables, const uint64_t board, filter_set *filters)
+{
+    search_options options;
+    search_options_init(&options);
+    switch (kind)
+    {
+    case ENGINE_DFS_PIECE:
+        options.order = ORDER_PIECE;
+        return engine_search(tables, board, &options);
+    case ENGINE_DFS_CELL:
+        options.order = ORDER_CELL;
+        return engine_search(tables, board, &options);
+    case ENGINE_MITM:
+        return mitm_count(tables, board, mitm_split(tables, board, MITM_SAMPLES), MITM_DEFAULT_MEMORY, filters, NULL);
+    case ENGINE_FRONTIER:
+        return frontier_count(tables, board, FRONTIER_DEFAULT_MEMORY, filters, NULL);
+    default:
+        return engine_search(tables, board, &options);
+    }
+}
+
+//-------------------------Hardware counters-------------------------
+
+void counters_open(counter_set *counters)
+{
+    static const uint32_t types[COUNTERS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+    static const uint64_t configs[COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+        PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16};
+
+    // Counters of this thread in user space, which the default perf_event_paranoid allows. The
+    // times enabled and running scale the counts when the kernel multiplexes them.
+    counters->available = 0;
+    int error = 0;
+    for (int c = 0; c < COUNTERS; c++)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[c];
+        attr.config = configs[c];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        counters->fds[c] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (counters->fds[c] >= 0)
+            counters->available++;
+        else
+            error = errno;
+    }
+
+    if (counters->available == 0)
+        fprintf(stderr, "Warning : hardware counters unavailable (%s), timing only\n", strerror(error));
+    else if (counters->available < COUNTERS)
+        for (int c = 0; c < COUNTERS; c++)
+            if (counters->fds[c] < 0)
+                fprintf(stderr, "Warning : %s counter unavailable\n", counter_names[c]);
+}
+
+void counters_start(const counter_set *counters)
+{
+    for (int c = 0; c < COUNTERS && counters->available; c++)
+        if (counters->fds[c] >= 0)
+        {
+            ioctl(counters->fds[c], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters->fds[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+}
+
+void counters_stop(const counter_set *counters, double *counts)
+{
+    for (int c = 0; c < COUNTERS; c++)
+    {
+        counts[c] = 0;
+        if (!counters->available || counters->fds[c] < 0)
+            continue;
+
+        ioctl(counters->fds[c], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t values[3]; // Count, time enabled, time running
+        if (read(counters->fds[c], values, sizeof(values)) == sizeof(values) && values[2] > 0)
+            counts[c] = (double)values[0] * values[1] / values[2];
+    }
+}
+
+void counters_close(counter_set *counters)
+{
+    for (int c = 0; c < COUNTERS && counters->available; c++)
+        if (counters->fds[c] >= 0)
+            close(counters->fds[c]);
+    counters->available = 0;
+}
+
+//-------------------------Output-------------------------
+
+static bool keep_solution(const puzzle_tables *tables, const uint16_t *placements, void *data)
+{
+    uint16_t *sample = (uint16_t *)data;
+    uint32_t pieces = tables->header->pieces;
+    uint32_t kept = sample[(size_t)OUTPUT_SAMPLE * pieces];
+    memcpy(sample + (size_t)kept * pieces, placements, sizeof(uint16_t) * pieces);
+    sample[(size_t)OUTPUT_SAMPLE * pieces] = kept + 1;
+    return kept + 1 < OUTPUT_SAMPLE;
+}
+
+void bench_output(const puzzle_tables *tables, const uint64_t board, const uint64_t count)
+{
+    static const char *format_names[] = {"text", "grid", "binary", "ndjson"};
+    uint32_t pieces = tables->header->pieces;
+
+    // The solutions of the first date having some, the count of them is stored after them
+    uint16_t *sample = (uint16_t *)calloc((size_t)OUTPUT_SAMPLE * pieces + 1, sizeof(uint16_t));
+    search_options options;
+    search_options_init(&options);
+    options.on_solution = keep_solution;
+    options.data = sample;
+    engine_search(tables, board, &options);
+    uint32_t kept = sample[(size_t)OUTPUT_SAMPLE * pieces];
+
+    int fd = open("/dev/null", O_WRONLY);
+    FILE *fp = fdopen(dup(fd), "w");
+    if (fd < 0 || fp == NULL || kept == 0)
+    {
+        fprintf(stderr, "Warning : output benchmark skipped\n");
+        free(sample);
+        return;
+    }
+
+    // The text format printed with a call per cell, as the solver used to, then every format of
+    // the writer
+    double seconds = write_stdio(fp, tables, sample, kept, count);
+    fprintf(stderr, "output %-6s %10.0f solutions/s\n", "stdio", count / seconds);
+
+    for (int f = OUTPUT_TEXT; f <= OUTPUT_NDJSON; f++)
+    {
+        solution_writer writer;
+        if (!output_open(&writer, tables, (output_format)f, fd))
+            break;
+        double start = now();
+        for (uint64_t c = 0; c < count; c++)
+            output_solution(&writer, sample + (size_t)(c % kept) * pieces);
+        output_flush(&writer);
+        seconds = now() - start;
+        fprintf(stderr, "output %-6s %10.0f solutions/s %8.1f MB/s %6.1f bytes per solution\n", format_names[f], count / seconds,
+                writer.bytes / seconds / 1e6, (double)writer.bytes / count);
+        output_close(&writer);
+    }
+
+    fclose(fp);
+    close(fd);
+    free(sample);
+}
+
+double write_stdio(FILE *fp, const puzzle_tables *tables, const uint16_t *solutions, const uint32_t sample, const uint64_t count)
+{
+    // Returns the seconds taken
+    double start = now();
+    for (uint64_t c = 0; c < count; c++)
+    {
+        const uint16_t *solution = solutions + (size_t)(c % sample) * tables->header->pieces;
+        fprintf(fp, "---------Solution %llu---------\n", (unsigned long long)c + 1);
+        for (int i = tables->header->pieces - 1; i >= 0; i--)
+        {
+            const placement *chosen = tables->placements + solution[i];
+            const variant_entry *variant = tables->variants + chosen->variant;
+            fprintf(fp, "\nPosition : (%d, %d)\n", chosen->x, chosen->y);
+            for (int y = 0; y < variant->height; y++)
+            {
+                for (int x = 0; x < variant->width; x++)
+                    fprintf(fp, variant->rows[y] & (1U << x) ? "1 " : ". ");
+                fprintf(fp, "\n");
+            }
+        }
+        fprintf(fp, "\n");
+    }
+    fflush(fp);
+    return now() - start;
+}
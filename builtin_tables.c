@@ -0,0 +1,22 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "tables.h"
+
+// Generated from puzzle.def by the Makefile
+#include "standard_tables.h"
+
+puzzle_tables *tables_builtin()
+{
+    static puzzle_tables tables = {
+        &standard_header,
+        standard_variants,
+        standard_placements,
+        standard_anchored,
+        standard_covering,
+        NULL,
+        0,
+        TABLES_STATIC};
+
+    return &tables;
+}
@@ -0,0 +1,301 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+#define CACHE_MAGIC "PZC1"
+#define CACHE_RECORD_HEADER 8 // kind, month, month_day, week_day, uint32 length
+
+//-------------------------Index-------------------------
+
+static uint32_t entry_key(const int kind, const int month, const int month_day, const int week_day)
+{
+    return (uint32_t)(uint8_t)kind | (uint32_t)(uint8_t)month << 8 | (uint32_t)(uint8_t)month_day << 16 | (uint32_t)(uint8_t)week_day << 24;
+}
+
+static uint32_t *find_slot(const cache *cache, const uint32_t key)
+{
+    // The slot of the key, or the empty slot where it would go
+    uint32_t i = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & cache->size_mask;
+    while (cache->slots[i] != 0)
+    {
+        const cache_entry *entry = cache->entries + cache->slots[i] - 1;
+        if (entry_key(entry->kind, entry->month, entry->month_day, entry->week_day) == key)
+            break;
+        i = (i + 1) & cache->size_mask;
+    }
+    return cache->slots + i;
+}
+
+static void grow_slots(cache *cache)
+{
+    uint32_t slots = cache->slots != NULL ? (cache->size_mask + 1) * 2 : 128;
+    free(cache->slots);
+    cache->slots = (uint32_t *)calloc(slots, sizeof(uint32_t));
+    cache->size_mask = slots - 1;
+    for (int i = 0; i < cache->count; i++)
+    {
+        const cache_entry *entry = cache->entries + i;
+        *find_slot(cache, entry_key(entry->kind, entry->month, entry->month_day, entry->week_day)) = i + 1;
+    }
+}
+
+//-------------------------Opening and closing-------------------------
+
+static void add_entry(cache *cache, const uint8_t *header, const uint8_t *payload, uint32_t length)
+{
+    // Half full at most, so that probes stay short
+    if (cache->slots == NULL || (uint32_t)cache->count * 2 >= cache->size_mask + 1)
+        grow_slots(cache);
+    if (cache->count == cache->capacity)
+    {
+        cache->capacity = cache->capacity ? cache->capacity * 2 : 64;
+        cache->entries = (cache_entry *)realloc(cache->entries, sizeof(cache_entry) * cache->capacity);
+    }
+
+    if (cache->data_length + length > cache->data_capacity)
+    {
+        while (cache->data_length + length > cache->data_capacity)
+            cache->data_capacity = cache->data_capacity ? cache->data_capacity * 2 : 4096;
+        cache->data = (uint8_t *)realloc(cache->data, cache->data_capacity);
+    }
+
+    // A later record of the same kind and date replaces the entry of the earlier one
+    uint32_t *slot = find_slot(cache, entry_key(header[0], (int8_t)header[1], (int8_t)header[2], (int8_t)header[3]));
+    if (*slot == 0)
+        *slot = ++cache->count;
+    cache_entry *entry = cache->entries + *slot - 1;
+    entry->kind = header[0];
+    entry->month = (int8_t)header[1];
+    entry->month_day = (int8_t)header[2];
+    entry->week_day = (int8_t)header[3];
+    entry->length = length;
+    entry->offset = cache->data_length;
+
+    memcpy(cache->data + cache->data_length, payload, length);
+    cache->data_length += length;
+}
+
+static void load_entries(cache *cache, FILE *fp)
+{
+    char magic[4];
+    uint64_t hash;
+    if (fread(magic, 1, 4, fp) != 4 || memcmp(magic, CACHE_MAGIC, 4) != 0)
+        return;
+    if (fread(&hash, sizeof(hash), 1, fp) != 1 || hash != cache->hash)
+        return;
+
+    uint8_t header[CACHE_RECORD_HEADER];
+    uint8_t *payload = NULL;
+    while (fread(header, 1, CACHE_RECORD_HEADER, fp) == CACHE_RECORD_HEADER)
+    {
+        uint32_t length;
+        memcpy(&length, header + 4, sizeof(length));
+
+        payload = (uint8_t *)realloc(payload, length ? length : 1);
+        // A truncated last record (interrupted write) is ignored
+        if (fread(payload, 1, length, fp) != length)
+            break;
+
+        add_entry(cache, header, payload, length);
+    }
+    free(payload);
+}
+
+cache *cache_open(uint64_t hash)
+{
+    const char *dir = getenv("PUZZLE_CACHE");
+    if (dir == NULL)
+        dir = CACHE_DIR;
+    if (*dir == '\0' || strcmp(dir, "off") == 0)
+        return NULL;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Warning : cannot create cache directory %s, caching disabled\n", dir);
+        return NULL;
+    }
+
+    cache *new_cache = (cache *)calloc(1, sizeof(cache));
+    new_cache->hash = hash;
+
+    size_t length = strlen(dir) + 32;
+    new_cache->path = (char *)malloc(length);
+    snprintf(new_cache->path, length, "%s/%016llx.cache", dir, (unsigned long long)hash);
+
+    // Records are appended under an exclusive lock, the shared one keeps them whole while reading
+    FILE *fp = fopen(new_cache->path, "rb");
+    if (fp != NULL)
+    {
+        flock(fileno(fp), LOCK_SH);
+        load_entries(new_cache, fp);
+        fclose(fp);
+    }
+
+    return new_cache;
+}
+
+void cache_close(cache *cache)
+{
+    if (cache == NULL)
+        return;
+
+    free(cache->path);
+    free(cache->entries);
+    free(cache->slots);
+    free(cache->data);
+    free(cache);
+}
+
+//-------------------------Lookups-------------------------
+
+static const cache_entry *find_entry(const cache *cache, cache_kind kind, int month, int month_day, int week_day)
+{
+    if (cache == NULL || cache->slots == NULL)
+        return NULL;
+
+    uint32_t slot = *find_slot(cache, entry_key(kind, month, month_day, week_day));
+    return slot != 0 ? cache->entries + slot - 1 : NULL;
+}
+
+bool cache_get_count(const cache *cache, int month, int month_day, int week_day, uint64_t *count)
+{
+    const cache_entry *entry = find_entry(cache, CACHE_COUNT, month, month_day, week_day);
+    if (entry == NULL || entry->length != sizeof(uint64_t))
+        return false;
+
+    memcpy(count, cache->data + entry->offset, sizeof(uint64_t));
+    return true;
+}
+
+bool cache_get_exists(const cache *cache, int month, int month_day, int week_day, bool *exists)
+{
+    // A known count answers the question as well
+    uint64_t count;
+    if (cache_get_count(cache, month, month_day, week_day, &count))
+    {
+        *exists = count > 0;
+        return true;
+    }
+
+    const cache_entry *entry = find_entry(cache, CACHE_EXISTS, month, month_day, week_day);
+    if (entry == NULL || entry->length != 1)
+        return false;
+
+    *exists = cache->data[entry->offset] != 0;
+    return true;
+}
+
+bool cache_get_solutions(const cache *cache, int month, int month_day, int week_day, uint32_t *count, int *pieces, const uint8_t **placements)
+{
+    const cache_entry *entry = find_entry(cache, CACHE_SOLUTIONS, month, month_day, week_day);
+    if (entry == NULL || entry->length < 5)
+        return false;
+
+    const uint8_t *data = cache->data + entry->offset;
+    memcpy(count, data, sizeof(uint32_t));
+    *pieces = data[4];
+    if (entry->length != 5 + (size_t)*count * *pieces * 3)
+        return false;
+
+    *placements = data + 5;
+    return true;
+}
+
+//-------------------------Insertions-------------------------
+
+static void put_entry(cache *cache, cache_kind kind, int month, int month_day, int week_day, const uint8_t *payload, uint32_t length)
+{
+    if (cache == NULL)
+        return;
+
+    // The file header if the file is new, then the record, written at once
+    size_t start = 4 + sizeof(cache->hash);
+    uint8_t *record = (uint8_t *)malloc(start + CACHE_RECORD_HEADER + length);
+    if (record == NULL)
+        return;
+    memcpy(record, CACHE_MAGIC, 4);
+    memcpy(record + 4, &cache->hash, sizeof(cache->hash));
+    uint8_t *header = record + start;
+    header[0] = kind;
+    header[1] = (uint8_t)month;
+    header[2] = (uint8_t)month_day;
+    header[3] = (uint8_t)week_day;
+    memcpy(header + 4, &length, sizeof(length));
+    memcpy(header + CACHE_RECORD_HEADER, payload, length);
+
+    // Several programs may append to the same file, the lock keeps their records apart and the file
+    // header written once
+    int fd = open(cache->path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    struct stat st;
+    if (fd < 0 || flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "Warning : cannot write to the cache %s : %s\n", cache->path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        free(record);
+        return;
+    }
+
+    const uint8_t *next = st.st_size == 0 ? record : header;
+    size_t left = record + start + CACHE_RECORD_HEADER + length - next;
+    while (left > 0)
+    {
+        ssize_t written = write(fd, next, left);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            break;
+        next += written;
+        left -= written;
+    }
+
+    // A partial record would hide every later one, it is cut off
+    if (left > 0)
+    {
+        fprintf(stderr, "Warning : cannot write to the cache %s : %s\n", cache->path, strerror(errno));
+        if (ftruncate(fd, st.st_size) != 0)
+            fprintf(stderr, "Warning : cannot truncate the cache %s : %s\n", cache->path, strerror(errno));
+    }
+    else
+        add_entry(cache, header, payload, length);
+
+    close(fd);
+    free(record);
+}
+
+void cache_put_count(cache *cache, int month, int month_day, int week_day, uint64_t count)
+{
+    put_entry(cache, CACHE_COUNT, month, month_day, week_day, (const uint8_t *)&count, sizeof(count));
+}
+
+void cache_put_exists(cache *cache, int month, int month_day, int week_day, bool exists)
+{
+    uint8_t value = exists ? 1 : 0;
+    put_entry(cache, CACHE_EXISTS, month, month_day, week_day, &value, 1);
+}
+
+void cache_put_solutions(cache *cache, int month, int month_day, int week_day, uint32_t count, int pieces, const uint8_t *placements)
+{
+    if (cache == NULL)
+        return;
+
+    uint32_t length = 5 + count * pieces * 3;
+    uint8_t *payload = (uint8_t *)malloc(length);
+    memcpy(payload, &count, sizeof(count));
+    payload[4] = (uint8_t)pieces;
+    memcpy(payload + 5, placements, (size_t)count * pieces * 3);
+
+    put_entry(cache, CACHE_SOLUTIONS, month, month_day, week_day, payload, length);
+    free(payload);
+
+    cache_put_count(cache, month, month_day, week_day, count);
+}
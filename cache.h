@@ -0,0 +1,58 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Results are stored in CACHE_DIR/<puzzle hash>.cache, the directory can be
+// changed with the PUZZLE_CACHE environment variable ("off" disables caching)
+#define CACHE_DIR ".puzzle_cache"
+
+typedef enum cache_kind
+{
+    CACHE_COUNT = 1,
+    CACHE_EXISTS = 2,
+    CACHE_SOLUTIONS = 3
+} cache_kind;
+
+typedef struct cache_entry
+{
+    uint8_t kind;
+    int8_t month, month_day, week_day;
+    uint32_t length;
+    size_t offset;
+} cache_entry;
+
+typedef struct cache
+{
+    uint64_t hash;
+    char *path;
+
+    // One entry per kind and date, the latest record's, and an open-addressing index of them by key
+    // holding entry indexes plus one, 0 for an empty slot
+    cache_entry *entries;
+    int count, capacity;
+    uint32_t *slots;
+    uint32_t size_mask;
+
+    uint8_t *data;
+    size_t data_length, data_capacity;
+} cache;
+
+// Opening and closing, cache_open returns NULL when caching is disabled
+cache *cache_open(uint64_t hash);
+void cache_close(cache *cache);
+
+// Lookups, all of them return false on a miss
+bool cache_get_count(const cache *cache, int month, int month_day, int week_day, uint64_t *count);
+bool cache_get_exists(const cache *cache, int month, int month_day, int week_day, bool *exists);
+// Solutions are stored as (variant, x, y) bytes for each piece, variants counted from the piece's first one
+bool cache_get_solutions(const cache *cache, int month, int month_day, int week_day, uint32_t *count, int *pieces, const uint8_t **placements);
+
+// Insertions, appended to the cache file straight away
+void cache_put_count(cache *cache, int month, int month_day, int week_day, uint64_t count);
+void cache_put_exists(cache *cache, int month, int month_day, int week_day, bool exists);
+void cache_put_solutions(cache *cache, int month, int month_day, int week_day, uint32_t count, int pieces, const uint8_t *placements);
+
+#endif
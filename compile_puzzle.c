@@ -0,0 +1,31 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "tables.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: ./compile_puzzle puzzle.def puzzle.bin|tables.h\n");
+        exit(1);
+    }
+
+    puzzle_tables *tables = tables_parse(argv[1]);
+    if (tables == NULL)
+        exit(1);
+
+    // A .h output is the C source of the tables, for builds which embed them
+    size_t length = strlen(argv[2]);
+    bool source = length > 2 && strcmp(argv[2] + length - 2, ".h") == 0;
+    if (!(source ? tables_write_source(tables, argv[2]) : tables_write(tables, argv[2])))
+        exit(1);
+
+    const tables_header *header = tables->header;
+    printf("%s: %u pieces, %u variants, %u placements, %zu bytes\n", argv[2], header->pieces, header->variants, header->placements, tables->length);
+
+    tables_free(tables);
+    return 0;
+}
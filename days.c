@@ -4,576 +4,295 @@
 #include <string.h>
 #include <time.h>
 #include <stdint.h>
-
-#define BOARD_HEIGHT 8
-#define BOARD_WIDTH 7
-#define BOARD_SIZE (sizeof(uint8_t) * BOARD_HEIGHT)
-
-typedef struct shapes
-{
-    int height, width;
-    struct shapes *next;
-    uint8_t *mask;
-} shapes;
-
-typedef struct shapes_list
-{
-    struct shapes *shapes;
-    struct shapes_list *next;
-} shapes_list;
-
-int gcount = 0;
-
-// Checking the board and shapes
-int count_free_spots(const uint8_t *mask);
-int count_full_spots(const shapes *shape);
-
-// Debugging
-void print_shape(const shapes *shape);
-void print_all_shapes(shapes *shape);
-void print_shape_list(shapes_list *list);
-
-// Memory freeing
-void free_shapes(shapes *shape);
-void free_all_shapes(shapes *shape);
-void free_list(shapes_list *list);
-
-// Shape generation
-shapes *load_shape_from_file(const char *file_name); //
-bool shapes_equal(const shapes *shape_1, const shapes *shape_2);
-bool shape_equal_in_list(const shapes *shape, shapes *other_shapes);
-bool rotate_last_90_degrees(shapes *shape);
-bool mirror_shape(shapes *shape);
-void add_shapes(shapes *new_shape, shapes_list *shapes_list, const bool mirror);
-
-// Board generation
-void print_board(const uint8_t *board);
-void mark_date(const int month, const int month_day, const int day, uint8_t *board);
-void generate_board(const int month, const int month_day, const int day, uint8_t *board);
-
-// Solutions generation
-bool new_can_place(const shapes *shape, const int x, const int y, const uint8_t *board, uint8_t *new_board);
-
-void exist_solution(const shapes_list *shapes_list, const uint8_t *board);
-
-int main(int argc)
-{
-    // Make shapes
-    shapes_list *slist = (shapes_list *)malloc(sizeof(shapes_list));
-    slist->next = NULL;
-    slist->shapes = NULL;
-
-    char filename[20];
-    for (int i = 1; i <= 10; i++)
-    {
-        sprintf(filename, "shapes/%d.txt", i);
-        shapes *shape = load_shape_from_file(filename);
-        add_shapes(shape, slist, false);
-    }
-
-    uint8_t board_test[BOARD_HEIGHT] = {0};
-    generate_board(0, 0, 0, board_test);
-
-    int board_spaces = count_free_spots(board_test);
-    int shape_blocks = 0;
-    shapes_list *shape_list_hold = slist;
-    while (shape_list_hold != NULL)
-    {
-        shape_blocks += count_full_spots(shape_list_hold->shapes);
-        shape_list_hold = shape_list_hold->next;
-    }
-
-    if (shape_blocks != board_spaces)
-    {
-        printf("The space which needs to be occupied on the board has %d spaces, the shapes however can fill %d spaces.\n", board_spaces, shape_blocks);
-        return 0;
-    }
-
-    clock_t start;
-    clock_t end;
-    for (int i = 0; i <= 11; i++)
-    {
-        for (int j = 0; j <= 30; j++)
-        {
-            for (int k = 0; k <= 6; k++)
-            {
-                gcount = 0;
-                uint8_t board[BOARD_HEIGHT] = {0};
-                generate_board(i, j, k, board);
-                start = clock();
-                exist_solution(slist, board);
-                end = clock();
-                printf("%d;%d;%d;%d;%f\n", i, j, k, gcount, ((double)(end - start)) / CLOCKS_PER_SEC);
-            }
-        }
-    }
-
-    // Free list
-    free_list(slist);
-}
-
-//--------------------Pre-checks--------------------
-
-int count_free_spots(const uint8_t *board)
-{
-    int v = 0;
-    for (int i = 0; i < BOARD_HEIGHT; i++)
-    {
-        uint8_t line = *(board + i);
-        for (int j = 0; j < BOARD_WIDTH; j++)
-            if (!(line & (1ULL << j)))
-                v++;
-    }
-
-    return v;
-}
-
-int count_full_spots(const shapes *shape)
-{
-    int v = 0;
-
-    uint8_t *mask = shape->mask;
-    for (int i = 0; i < shape->height; i++)
-        for (int j = 0; j < shape->width; j++)
-            if (*(mask + i) & (1ULL << j))
-                v++;
-
-    return v;
-}
-
-//-------------------------Debugging-------------------------
-
-void print_shape(const shapes *shape)
+#include <unistd.h>
+#include <pthread.h>
+
+#include "tables.h"
+#include "engine.h"
+#include "cache.h"
+#include "profile.h"
+#include "mitm.h"
+#include "frontier.h"
+#include "schedule.h"
+#include "trace.h"
+
+typedef struct year_date
 {
-    uint8_t *mask = shape->mask;
-
-    for (int i = 0; i < shape->height; i++)
-    {
-        for (int j = 0; j < shape->width; j++)
-        {
-            if (*(mask + i) & (1ULL << j))
-                printf("1 ");
-            else
-                printf(". ");
-        }
-        printf("\n");
-    }
-}
-
-void print_all_shapes(shapes *shape)
+    int date[3];
+    bool cached;
+    uint64_t solutions;
+    double seconds;
+    int remaining; // Scheduled jobs of the date not solved yet
+} year_date;
+
+typedef struct year_sweep
 {
-    shapes *shapes_temp = shape;
-    while (shapes_temp != NULL)
-    {
-        print_shape(shapes_temp);
-        puts(" ");
-        shapes_temp = shapes_temp->next;
-    }
-}
-
-void print_shape_list(shapes_list *list)
+    const puzzle_tables *tables;
+    const char *engine;
+    bool parity, sizes;
+
+    year_date *dates;
+    int date_count;
+    int (*pending)[3];
+    int *pending_index; // Index in dates of every pending date
+    schedule_job *jobs;
+    int job_count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int next_job;
+} year_sweep;
+
+// Solving
+search_result solve_board(const puzzle_tables *tables, const char *engine, const uint64_t board, const uint16_t *prefix, const int depth, filter_set *filters);
+double now_seconds();
+
+// Scheduled sweep
+void *sweep_worker(void *data);
+void sweep_year(year_sweep *s, cache *results, const int jobs, const char *timings_path);
+
+search_result solve_board(const puzzle_tables *tables, const char *engine, const uint64_t board, const uint16_t *prefix, const int depth, filter_set *filters)
 {
-    shapes_list *shapes_list_temp = list;
-    while (shapes_list_temp != NULL)
-    {
-        print_all_shapes(shapes_list_temp->shapes);
-        shapes_list_temp = shapes_list_temp->next;
-    }
+    if (strcmp(engine, "mitm") == 0)
+        return mitm_count(tables, board, mitm_split(tables, board, MITM_SAMPLES), MITM_DEFAULT_MEMORY, filters, NULL);
+    if (strcmp(engine, "frontier") == 0)
+        return frontier_count(tables, board, FRONTIER_DEFAULT_MEMORY, filters, NULL);
+
+    search_options options;
+    search_options_init(&options);
+    return engine_search_from(tables, board, prefix, depth, &options);
 }
 
-//-------------------------Memory freeing-------------------------
-
-void free_shapes(shapes *shape)
+double now_seconds()
 {
-    free(shape->mask);
-    free(shape);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
 }
 
-void free_all_shapes(shapes *shape)
-{
-    shapes *temp;
-    while (shape != NULL)
-    {
-        temp = shape;
-        shape = shape->next;
-        free_shapes(temp);
-    }
-}
+//-------------------------Scheduled sweep-------------------------
 
-void free_list(shapes_list *list)
+void *sweep_worker(void *data)
 {
-    shapes_list *temp;
-    while (list != NULL)
-    {
-        temp = list;
-        list = list->next;
-        free_all_shapes(temp->shapes);
-        free(temp);
-    }
-}
-
-//-------------------------Shape Generation-------------------------
-
-shapes *load_shape_from_file(const char *file_name)
-{
-    shapes *shape = (shapes *)malloc(sizeof(shapes));
-
-    FILE *fp;
-
-    fp = fopen(file_name, "r");
-    if (fp == NULL)
-    {
-        fprintf(stderr, "Erreur : Impossible d'ouvrir le fichier %s\n", file_name);
-        exit(1);
-    }
-    shape->next = NULL;
-    shape->height = 0;
-    shape->width = 0;
-    fscanf(fp, "%d", &shape->height);
-    fscanf(fp, "%d", &shape->width);
-
-    uint8_t *mask = (uint8_t *)malloc(sizeof(uint8_t) * shape->height);
-    if (mask == NULL)
-    {
-        fprintf(stderr, "Erreur : Impossible d'allouer de la mémoire\n");
-        exit(1);
-    }
-
-    int data;
-    uint8_t *current_line;
-    for (int i = 0; i < shape->height; i++)
-    {
-        current_line = mask + i;
-        *current_line = 0;
-        for (int j = 0; j < shape->width; j++)
-        {
-            fscanf(fp, "%d", &data);
-            if (data != 0)
-                *(mask + i) |= 1ULL << j;
-        }
-    }
-
-    shape->mask = mask;
-
-    fclose(fp);
-
-    return shape;
-}
-
-bool shapes_equal(const shapes *shape_1, const shapes *shape_2)
-{
-    // Start by comparing the sizes
-    if ((shape_1->width != shape_2->width) || (shape_1->height != shape_2->height))
-        return false;
-
-    uint8_t *mask_1 = shape_1->mask;
-    uint8_t *mask_2 = shape_2->mask;
-
-    // Then compare the contents
-    for (int i = 0; i < shape_1->height; i++)
-    {
-        if (*(mask_1 + i) != *(mask_2 + i))
-            return false;
-    }
+    year_sweep *s = (year_sweep *)data;
 
-    return true;
-}
+    // Filters count their cuts, every thread has its own
+    filter_set filters;
+    filters_init(&filters, s->tables, s->parity, s->sizes);
+    filter_set *active = s->parity || s->sizes ? &filters : NULL;
 
-bool shape_equal_in_list(const shapes *shape, shapes *other_shapes)
-{
-    shapes *temp = other_shapes;
-    while (temp != NULL)
+    pthread_mutex_lock(&s->lock);
+    while (s->next_job < s->job_count)
     {
-        if (shapes_equal(shape, temp))
+        int index = s->next_job++;
+        const schedule_job *job = s->jobs + index;
+        pthread_mutex_unlock(&s->lock);
+
+        year_date *date = s->dates + s->pending_index[job->date_index];
+        uint64_t board;
+        tables_date_board(s->tables, date->date, &board);
+        double trace_start = trace_enabled() ? trace_clock() : 0;
+        double start = now_seconds();
+        search_result result = solve_board(s->tables, s->engine, board, job->prefix, job->depth, active);
+        double seconds = now_seconds() - start;
+
+        if (trace_enabled())
         {
-            return true;
+            trace_task task = {{date->date[0], date->date[1], date->date[2]}, job->depth > 0 ? index : -1, job->depth, result.solutions, result.nodes};
+            trace_record(job->depth > 0 ? "unit" : "date", -1, trace_start, &task);
         }
 
-        temp = temp->next;
+        pthread_mutex_lock(&s->lock);
+        date->solutions += result.solutions;
+        date->seconds += seconds;
+        if (--date->remaining == 0)
+            pthread_cond_broadcast(&s->cond);
     }
+    pthread_mutex_unlock(&s->lock);
 
-    return false;
+    filters_free(&filters);
+    return NULL;
 }
 
-bool rotate_last_90_degrees(shapes *shape)
+void sweep_year(year_sweep *s, cache *results, const int jobs, const char *timings_path)
 {
-    shapes *current = shape;
-    while (current->next != NULL)
+    s->pending = (int (*)[3])malloc(sizeof(int[3]) * (s->date_count + 1));
+    s->pending_index = (int *)malloc(sizeof(int) * (s->date_count + 1));
+    int pending_count = 0;
+    for (int i = 0; i < s->date_count; i++)
     {
-        current = current->next;
-    }
-
-    // Declare new shape
-    shapes *new_shape = (shapes *)malloc(sizeof(shapes));
-
-    new_shape->width = current->height;
-    new_shape->height = current->width;
-
-    new_shape->next = NULL;
-
-    uint8_t *mask = (uint8_t *)malloc(sizeof(uint8_t) * new_shape->height);
-
-    uint8_t *current_line;
-
-    // Loop over shape and rotate it 90deg by swapping x and y when getting from original shape
-    for (int i = 0; i < new_shape->height; i++)
-    {
-        current_line = mask + i;
-        *current_line = 0;
-        for (int j = 0; j < new_shape->width; j++)
-        {
-            if (*(current->mask + current->height - 1 - j) & (1ULL << i))
-            {
-                *(mask + i) |= (1ULL << j);
-            }
-        }
-    }
-
-    // Add mask to shape
-    new_shape->mask = mask;
+        year_date *date = s->dates + i;
+        date->cached = cache_get_count(results, date->date[0], date->date[1], date->date[2], &date->solutions);
+        if (date->cached)
+            continue;
 
-    // Check if shape already in shapes array
-    if (shape_equal_in_list(new_shape, shape))
-    {
-        free_shapes(new_shape);
-        return true;
+        memcpy(s->pending[pending_count], date->date, sizeof(date->date));
+        s->pending_index[pending_count++] = i;
     }
 
-    shapes *temp = shape;
-
-    while (temp->next != NULL)
+    // Longest jobs first, only the depth-first search can solve the units of a split date
+    double *timings = timings_path != NULL ? schedule_read_timings(s->tables, timings_path) : NULL;
+    int parts = strcmp(s->engine, "dfs") == 0 ? jobs : 1;
+    s->job_count = schedule_dates(s->tables, (const int (*)[3])s->pending, pending_count, timings, parts, &s->jobs);
+    for (int i = 0; i < s->job_count; i++)
+        s->dates[s->pending_index[s->jobs[i].date_index]].remaining++;
+    free(timings);
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * jobs);
+    for (int i = 0; i < jobs; i++)
+        pthread_create(threads + i, NULL, sweep_worker, s);
+
+    // Dates are printed in year order as soon as all their jobs are solved, seconds add up their jobs
+    pthread_mutex_lock(&s->lock);
+    for (int i = 0; i < s->date_count; i++)
     {
-        temp = temp->next;
-    }
-
-    temp->next = new_shape;
-
-    return false;
-}
-
-bool mirror_shape(shapes *shape)
-{
-    shapes *current = shape;
-
-    // Declare new shape
-    shapes *new_shape = (shapes *)malloc(sizeof(shapes));
-
-    new_shape->width = current->width;
-    new_shape->height = current->height;
-    new_shape->next = NULL;
-
-    uint8_t *mask = (uint8_t *)malloc(sizeof(uint8_t) * new_shape->height);
-
-    uint8_t *current_line;
-
-    // Loop over shape and mirror it by swapping x and y when getting from original shape
-    for (int i = 0; i < new_shape->height; i++)
-    {
-        current_line = mask + i;
-        *current_line = 0;
-        for (int j = 0; j < new_shape->width; j++)
+        year_date *date = s->dates + i;
+        if (date->remaining > 0)
         {
-            if (*(current->mask + i) & (1ULL << (new_shape->width - 1 - j)))
-            {
-                *(mask + i) |= (1ULL << j);
-            }
+            fflush(stdout);
+            while (date->remaining > 0)
+                pthread_cond_wait(&s->cond, &s->lock);
         }
+        if (!date->cached)
+            cache_put_count(results, date->date[0], date->date[1], date->date[2], date->solutions);
+        printf("%d;%d;%d;%llu;%f\n", date->date[0], date->date[1], date->date[2], (unsigned long long)date->solutions, date->seconds);
     }
+    pthread_mutex_unlock(&s->lock);
 
-    // Add mask to shape
-    new_shape->mask = mask;
-
-    // Check if shape already in shapes array
-    if (shape_equal_in_list(new_shape, shape))
-    {
-        free_shapes(new_shape);
-        return true;
-    }
-
-    shapes *temp = shape;
-
-    while (temp->next != NULL)
-    {
-        temp = temp->next;
-    }
-
-    temp->next = new_shape;
-
-    return false;
-}
-
-void add_shapes(shapes *new_shape, shapes_list *all_shapes, const bool mirror)
-{
-    // For each rotation create a shape and make it from the previous shape,
-    // then check it isn't equal to other shapes in list
-
-    bool isdone = rotate_last_90_degrees(new_shape); // 90deg rotations
-    if (!isdone)
-        isdone = rotate_last_90_degrees(new_shape); // 180deg rotations
-    if (!isdone)
-        isdone = rotate_last_90_degrees(new_shape); // 270deg rotations
-
-    if (mirror)
-    {
-        isdone = mirror_shape(new_shape); // Flip
-
-        if (!isdone)
-            isdone = rotate_last_90_degrees(new_shape); // 90deg rotations of flip
-        if (!isdone)
-            isdone = rotate_last_90_degrees(new_shape); // 180deg rotations of flip
-        if (!isdone)
-            isdone = rotate_last_90_degrees(new_shape); // 270deg rotations of flip
-    }
-
-    if ((all_shapes)->shapes == NULL)
-    {
-        (all_shapes)->shapes = new_shape;
-        all_shapes->next = NULL;
-        return;
-    }
-
-    shapes_list *new_list = (shapes_list *)malloc(sizeof(shapes_list));
+    for (int i = 0; i < jobs; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
 
-    new_list->next = NULL;
-    new_list->shapes = new_shape;
-
-    shapes_list *current = all_shapes;
-    while (current->next != NULL)
-    {
-        current = current->next;
-    }
-
-    current->next = new_list;
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->lock);
+    free(s->jobs);
+    free(s->pending_index);
+    free(s->pending);
 }
 
-//-------------------------Board Generation-------------------------
-
-void print_board(const uint8_t *board)
+int main(int argc, char *argv[])
 {
-    for (int i = 0; i < BOARD_HEIGHT; i++)
+    const char *puzzle_path = NULL;
+    const char *engine = "dfs";
+    const char *timings_path = NULL;
+    bool parity = true, sizes = true;
+    int jobs = 1;
+    int option;
+    while ((option = getopt(argc, argv, "p:e:f:j:t:T:")) != -1)
     {
-        uint8_t line = *(board + i);
-        for (int j = 0; j < BOARD_WIDTH; j++)
+        if (option == 'p')
+            puzzle_path = optarg;
+        else if (option == 'j' && atoi(optarg) > 0)
+            jobs = atoi(optarg);
+        else if (option == 't')
+            timings_path = optarg;
+        else if (option == 'T' && trace_open(optarg))
+            continue;
+        else if (option == 'f' && filters_parse(optarg, &parity, &sizes))
+            continue;
+        else if (option == 'e' && (strcmp(optarg, "dfs") == 0 || strcmp(optarg, "mitm") == 0 || strcmp(optarg, "frontier") == 0))
+            engine = optarg;
+        else
         {
-            if (line & (1ULL << j))
-                printf("1 ");
-            else
-                printf(". ");
+            fprintf(stderr, "Usage: ./days [-p puzzle.def|puzzle.bin] [-e dfs|mitm|frontier] [-f parity,sizes|all|none] [-j threads] [-t timings] [-T trace.json]\n");
+            exit(1);
         }
-        printf("\n");
     }
-}
-
-void mark_date(const int month, const int month_day, const int day, uint8_t *board)
-{
-    // 1 on the board corresponds to a block (not placeable slot)
-    if (month <= 5)
-        board[0] |= 1UL << month;
-    else
-        board[1] |= 1UL << month - 6;
-
-    // Defining the month-day position
-    board[(month_day / 7) + 2] |= 1UL << (month_day % 7);
-
-    // Defining the day
-    if (day <= 3)
-        board[6] |= 1UL << (day + 3);
-    else
-        board[7] |= 1UL << day;
-}
-
-void generate_board(const int month, const int month_day, const int day, uint8_t *board)
-{
-    // First blocks the date slots
-    mark_date(month, month_day, day, board);
 
-    // Blocks the border slots
-    board[0] |= 1UL << 6;
-    board[1] |= 1UL << 6;
-    board[7] |= 0x0F; // 0 0 0 0 1 1 1 1
-}
-
-//-----------------------------------FIND SOLUTIONS-----------------------------------
-bool can_place(const shapes *shape, const int x, const int y, const uint8_t *board)
-{
-    uint8_t *mask = shape->mask;
+    // Make shapes
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    tables = profile_apply(tables);
 
-    for (int i = 0; i < shape->height; i++)
-    {
-        if (*(board + i + y) & (*(mask + i) << x))
-            return false;
-    }
+    if (!tables_check_dates(tables))
+        exit(1);
 
-    return true;
-}
+    // Repeated queries are answered from the cache, its key changes with the puzzle definition
+    cache *results = cache_open(tables->header->hash);
 
-void place(const shapes *shape, const int x, const int y, uint8_t *board)
-{
-    uint8_t *mask = shape->mask;
+    int test_targets[3] = {0, 0, 0};
+    uint64_t board_test;
+    tables_date_board(tables, test_targets, &board_test);
 
-    int i = shape->height;
+    int board_spaces = tables_free_cells(tables, board_test);
+    int shape_blocks = tables_pieces_area(tables);
 
-    while (i)
+    if (shape_blocks != board_spaces)
     {
-        i--;
-        *(board + i + y) |= (*(mask + i) << x);
+        printf("The space which needs to be occupied on the board has %d spaces, the shapes however can fill %d spaces.\n", board_spaces, shape_blocks);
+        cache_close(results);
+        tables_free(tables);
+        return 0;
     }
-}
-
-bool new_can_place(const shapes *shape, const int x, const int y, const uint8_t *board, uint8_t *new_board)
-{
-    uint8_t *mask = shape->mask;
-    uint8_t *new_board_pointer = new_board + y;
-
-    int i = shape->height;
 
-    while (i)
+    if (jobs > 1)
     {
-        i--;
-
-        uint8_t board_value = *(board + i + y);
-        uint8_t mask_value = *(mask + i) << x;
-
-        if (board_value & mask_value)
-            return false;
-
-        *(new_board_pointer + i) = board_value | mask_value;
-    }
-
-    return true;
-}
+        year_sweep s;
+        memset(&s, 0, sizeof(s));
+        s.tables = tables;
+        s.engine = engine;
+        s.parity = parity;
+        s.sizes = sizes;
+        s.dates = (year_date *)calloc(tables_date_range(tables, 0) * tables_date_range(tables, 1) * tables_date_range(tables, 2) + 1, sizeof(year_date));
+        for (int i = 0; i < tables_date_range(tables, 0); i++)
+            for (int j = 0; j < tables_date_range(tables, 1); j++)
+                for (int k = 0; k < tables_date_range(tables, 2); k++)
+                {
+                    int *date = s.dates[s.date_count++].date;
+                    date[0] = i;
+                    date[1] = j;
+                    date[2] = k;
+                }
 
-void exist_solution(const shapes_list *shapes_list, const uint8_t *board)
-{
-    if (shapes_list == NULL)
-    {
-        gcount++;
-        return;
+        sweep_year(&s, results, jobs, timings_path);
+        trace_close();
+        free(s.dates);
+        cache_close(results);
+        tables_free(tables);
+        return 0;
     }
 
-    shapes *current_shape = shapes_list->shapes;
+    filter_set filters;
+    if (!filters_init(&filters, tables, parity, sizes))
+        exit(1);
+    filter_set *active = parity || sizes ? &filters : NULL;
 
-    // For each shape variant
-    while (current_shape != NULL)
+    clock_t start;
+    clock_t end;
+    for (int i = 0; i < tables_date_range(tables, 0); i++)
     {
-        int h = BOARD_HEIGHT - current_shape->height + 1;
-        int w = BOARD_WIDTH - current_shape->width + 1;
-
-        // For each slots
-        for (int y = 0; y < h; y++)
+        for (int j = 0; j < tables_date_range(tables, 1); j++)
         {
-            for (int x = 0; x < w; x++)
+            for (int k = 0; k < tables_date_range(tables, 2); k++)
             {
-                uint8_t new_board[BOARD_HEIGHT];
-                memcpy(new_board, board, BOARD_SIZE);
-
-                if (new_can_place(current_shape, x, y, board, new_board))
+                uint64_t count;
+                start = clock();
+                if (!cache_get_count(results, i, j, k, &count))
                 {
-                    exist_solution(shapes_list->next, new_board);
+                    int targets[3] = {i, j, k};
+                    uint64_t board;
+                    tables_date_board(tables, targets, &board);
+                    double trace_start = trace_enabled() ? trace_clock() : 0;
+                    search_result result = solve_board(tables, engine, board, NULL, 0, active);
+                    count = result.solutions;
+                    if (trace_enabled())
+                    {
+                        trace_task task = {{i, j, k}, -1, 0, result.solutions, result.nodes};
+                        trace_record("date", -1, trace_start, &task);
+                    }
+                    cache_put_count(results, i, j, k, count);
                 }
+                end = clock();
+                printf("%d;%d;%d;%llu;%f\n", i, j, k, (unsigned long long)count, ((double)(end - start)) / CLOCKS_PER_SEC);
             }
         }
-
-        current_shape = current_shape->next;
     }
-}
\ No newline at end of file
+
+    trace_close();
+    filters_free(&filters);
+    cache_close(results);
+    tables_free(tables);
+}
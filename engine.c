@@ -0,0 +1,842 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "engine.h"
+#include "runs.h"
+
+// Random descents of the estimate a progress report compares the nodes to
+#define PROGRESS_SAMPLES 256
+
+// State shared by every worker of a search
+typedef struct search_shared
+{
+    const puzzle_tables *tables;
+    const search_options *options;
+    uint64_t board;
+    int depth; // Pieces already placed by the prefix
+    uint32_t fixed; // Pieces placed by options->fixed
+    uint32_t first; // First piece to place, the first one after the prefix which isn't fixed
+    uint32_t level, used; // Pieces placed before the search, and which ones for the dynamic orders
+    uint8_t next[MAX_PIECES + 1]; // Next piece to place after each piece in the fixed order
+    bool parallel;
+    bool ordered; // Parallel solutions go to the workers' runs, to be merged in search order
+    bool checking; // Budget or progress to check every CHECK_NODES nodes
+
+    // Dynamic orders, words bits per placements bitset and one bitset per cell of the placements covering it
+    int words;
+    uint64_t *covers;
+
+    // Progress, nodes published by the workers and the time of the last report in nanoseconds
+    uint64_t start_time;
+    double estimated_nodes;
+    atomic_uint_fast64_t published_nodes;
+    atomic_uint_fast64_t last_report;
+
+    atomic_uint_fast64_t found;
+    atomic_bool stop, expired;
+    atomic_uint next_branch;
+    atomic_uint finished_branches; // Branches of the first piece searched to the end by the workers
+    pthread_mutex_t lock;
+} search_shared;
+
+typedef struct search_context
+{
+    search_shared *shared;
+    search_result result;
+    uint16_t chosen[MAX_PIECES];
+    uint16_t path[MAX_PIECES]; // Dynamic orders, the placement chosen at each level
+    solution_run *run;
+    uint64_t *alive; // Dynamic orders, the legal placements at each depth
+    uint64_t published; // Nodes already added to the shared count
+
+    // Where the search was when it stopped. Dynamic orders keep the index of the current candidate
+    // and the number of candidates of each level, fixed orders find them again from chosen.
+    int stop_level;
+    bool in_branch; // A worker stopped within a branch of the first piece
+    uint32_t branch[MAX_PIECES], branches[MAX_PIECES];
+} search_context;
+
+void search_options_init(search_options *options)
+{
+    memset(options, 0, sizeof(search_options));
+    options->jobs = 1;
+    options->order = ORDER_FIXED;
+}
+
+void search_token_init(search_token *token)
+{
+    atomic_init(&token->cancelled, false);
+}
+
+void search_cancel(search_token *token)
+{
+    atomic_store(&token->cancelled, true);
+}
+
+bool engine_parse_order(const char *name, search_order *order)
+{
+    if (strcmp(name, "fixed") == 0)
+        *order = ORDER_FIXED;
+    else if (strcmp(name, "piece") == 0)
+        *order = ORDER_PIECE;
+    else if (strcmp(name, "cell") == 0)
+        *order = ORDER_CELL;
+    else
+        return false;
+    return true;
+}
+
+//-------------------------Budget and progress-------------------------
+
+static uint64_t now_nanoseconds()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+double engine_clock()
+{
+    return now_nanoseconds() * 1e-9;
+}
+
+bool engine_expired(const search_budget *budget)
+{
+    if (budget == NULL)
+        return false;
+    if (budget->cancel != NULL && atomic_load_explicit(&budget->cancel->cancelled, memory_order_relaxed))
+        return true;
+    return budget->deadline > 0 && engine_clock() >= budget->deadline;
+}
+
+static double path_fraction(const search_context *context, const uint32_t first, const uint32_t placed)
+{
+    const search_shared *shared = context->shared;
+    const tables_header *header = shared->tables->header;
+    const placement *placements = shared->tables->placements;
+
+    // Each level adds the share of its siblings already searched, within the share of its parent.
+    // Past a few levels the shares are too small to matter.
+    uint64_t board = shared->board;
+    for (uint32_t piece = shared->depth; piece < first; piece++)
+        if (!((shared->fixed >> piece) & 1))
+            board |= placements[context->chosen[piece]].mask;
+
+    double fraction = 0, weight = 1;
+    for (uint32_t piece = first; piece < placed && piece < first + 8; piece++)
+    {
+        if ((shared->fixed >> piece) & 1)
+            continue;
+
+        uint32_t before = 0, fitting = 0;
+        for (uint32_t p = header->piece_placements[piece]; p < header->piece_placements[piece + 1]; p++)
+            if (!(board & placements[p].mask))
+            {
+                before += p < context->chosen[piece];
+                fitting++;
+            }
+        if (fitting == 0)
+            break;
+
+        fraction += weight * before / fitting;
+        weight /= fitting;
+        board |= placements[context->chosen[piece]].mask;
+    }
+    return fraction;
+}
+
+static double search_fraction(const search_context *context, const uint32_t placed, const bool in_branch)
+{
+    // Within a branch of the first piece, or from the start of the search
+    const search_shared *shared = context->shared;
+    if (shared->options->order == ORDER_FIXED)
+        return path_fraction(context, in_branch ? shared->first + 1 : (uint32_t)shared->depth, placed);
+
+    double fraction = 0, weight = 1;
+    uint32_t first = shared->level + in_branch;
+    for (uint32_t level = first; level < placed && level < first + 8 && context->branches[level] > 0; level++)
+    {
+        fraction += weight * context->branch[level] / context->branches[level];
+        weight /= context->branches[level];
+    }
+    return fraction;
+}
+
+static void check_progress(search_context *context, const uint32_t placed)
+{
+    search_shared *shared = context->shared;
+    const search_options *options = shared->options;
+
+    atomic_fetch_add_explicit(&shared->published_nodes, context->result.nodes - context->published, memory_order_relaxed);
+    context->published = context->result.nodes;
+
+    // One worker reports per interval
+    uint64_t now = now_nanoseconds();
+    uint64_t last = atomic_load_explicit(&shared->last_report, memory_order_relaxed);
+    if (now - last < (uint64_t)(options->progress_interval * 1e9) || !atomic_compare_exchange_strong(&shared->last_report, &last, now))
+        return;
+
+    search_progress progress;
+    progress.nodes = atomic_load_explicit(&shared->published_nodes, memory_order_relaxed);
+    progress.solutions = atomic_load_explicit(&shared->found, memory_order_relaxed);
+    progress.elapsed = (now - shared->start_time) * 1e-9;
+
+    // A single search knows where it is in the tree, a parallel one compares the nodes to the
+    // estimate made when it started. The estimate doesn't model the dynamic orders' trees.
+    if (!shared->parallel)
+        progress.fraction = search_fraction(context, placed, false);
+    else if (shared->estimated_nodes > 0)
+        progress.fraction = fmin((double)progress.nodes / shared->estimated_nodes, 0.99);
+    else
+        progress.fraction = -1;
+    progress.eta = progress.fraction > 0 ? progress.elapsed * (1 - progress.fraction) / progress.fraction : -1;
+
+    if (shared->parallel)
+    {
+        pthread_mutex_lock(&shared->lock);
+        options->on_progress(&progress, options->progress_data);
+        pthread_mutex_unlock(&shared->lock);
+    }
+    else
+        options->on_progress(&progress, options->progress_data);
+}
+
+static void check_search(search_context *context, const uint32_t placed)
+{
+    search_shared *shared = context->shared;
+
+    // The other workers see the stop at their next node
+    if (engine_expired(&shared->options->budget))
+    {
+        atomic_store(&shared->expired, true);
+        atomic_store(&shared->stop, true);
+        return;
+    }
+    if (shared->options->on_progress != NULL)
+        check_progress(context, placed);
+}
+
+//-------------------------Search-------------------------
+
+static void report_solution(search_context *context)
+{
+    search_shared *shared = context->shared;
+    const search_options *options = shared->options;
+
+    // An ordered search keeps every solution of the branches it started, keyed by the placements in
+    // the order they were chosen, which is the pieces' order for the fixed order
+    if (shared->ordered)
+    {
+        atomic_fetch_add_explicit(&shared->found, 1, memory_order_relaxed);
+        context->result.solutions++;
+        run_append(context->run, options->order == ORDER_FIXED ? context->chosen : context->path, context->chosen);
+        return;
+    }
+
+    // Solutions past the limit, found by other workers at the same time, are dropped
+    uint64_t n = atomic_fetch_add(&shared->found, 1) + 1;
+    if (options->limit && n > options->limit)
+    {
+        atomic_store(&shared->stop, true);
+        return;
+    }
+
+    context->result.solutions++;
+
+    if (options->on_solution != NULL)
+    {
+        bool more;
+        if (shared->parallel)
+        {
+            pthread_mutex_lock(&shared->lock);
+            more = options->on_solution(shared->tables, context->chosen, options->data);
+            pthread_mutex_unlock(&shared->lock);
+        }
+        else
+            more = options->on_solution(shared->tables, context->chosen, options->data);
+
+        if (!more)
+            atomic_store(&shared->stop, true);
+    }
+
+    if (options->limit && n == options->limit)
+        atomic_store(&shared->stop, true);
+}
+
+static void search(search_context *context, const uint32_t piece, const uint64_t board)
+{
+    const puzzle_tables *tables = context->shared->tables;
+    const tables_header *header = tables->header;
+
+    if (piece == header->pieces)
+    {
+        report_solution(context);
+        return;
+    }
+
+    const placement *placements = tables->placements;
+    uint32_t end = header->piece_placements[piece + 1];
+    uint32_t next = context->shared->next[piece];
+
+    // Every placement of the piece which doesn't overlap the board
+    for (uint32_t p = header->piece_placements[piece]; p < end; p++)
+    {
+        if (board & placements[p].mask)
+            continue;
+
+        context->chosen[piece] = p;
+        if (!(++context->result.nodes & (CHECK_NODES - 1)) && context->shared->checking)
+            check_search(context, piece + 1);
+        search(context, next, board | placements[p].mask);
+
+        if (atomic_load_explicit(&context->shared->stop, memory_order_relaxed))
+        {
+            // The deepest level notices the stop first
+            if (context->stop_level < 0)
+                context->stop_level = piece + 1;
+            return;
+        }
+    }
+}
+
+//-------------------------Dynamic orders-------------------------
+
+static void build_covers(search_shared *shared)
+{
+    const puzzle_tables *tables = shared->tables;
+    const tables_header *header = tables->header;
+
+    shared->words = (header->placements + 63) / 64;
+    shared->covers = (uint64_t *)calloc((size_t)64 * shared->words, sizeof(uint64_t));
+    for (int cell = 0; cell < 64; cell++)
+        for (uint32_t i = header->covering_start[cell]; i < header->covering_start[cell + 1]; i++)
+            shared->covers[cell * shared->words + tables->covering[i] / 64] |= 1ULL << (tables->covering[i] % 64);
+}
+
+static void clear_range(uint64_t *bits, const uint32_t start, const uint32_t end)
+{
+    for (uint32_t i = start; i < end; i++)
+        bits[i / 64] &= ~(1ULL << (i % 64));
+}
+
+static int count_range(const uint64_t *bits, const uint32_t start, const uint32_t end)
+{
+    if (start >= end)
+        return 0;
+
+    uint32_t first = start / 64, last = (end - 1) / 64;
+    uint64_t head = ~0ULL << (start % 64);
+    uint64_t tail = ~0ULL >> (63 - (end - 1) % 64);
+    if (first == last)
+        return __builtin_popcountll(bits[first] & head & tail);
+
+    int count = __builtin_popcountll(bits[first] & head) + __builtin_popcountll(bits[last] & tail);
+    for (uint32_t w = first + 1; w < last; w++)
+        count += __builtin_popcountll(bits[w]);
+    return count;
+}
+
+static void initial_alive(const search_shared *shared, uint64_t *alive)
+{
+    const tables_header *header = shared->tables->header;
+    const placement *placements = shared->tables->placements;
+
+    // Placements of the pieces after the prefix which aren't fixed and fit the board
+    memset(alive, 0, sizeof(uint64_t) * shared->words);
+    for (uint32_t p = header->piece_placements[shared->depth]; p < header->placements; p++)
+        if (!(shared->board & placements[p].mask) && !((shared->fixed >> placements[p].piece) & 1))
+            alive[p / 64] |= 1ULL << (p % 64);
+}
+
+static void place_alive(const search_shared *shared, const uint64_t *from, uint64_t *to, const uint32_t p)
+{
+    const tables_header *header = shared->tables->header;
+    const placement *chosen = shared->tables->placements + p;
+    int words = shared->words;
+
+    // Placements overlapping the chosen one and the other placements of its piece are gone
+    memcpy(to, from, sizeof(uint64_t) * words);
+    for (uint64_t mask = chosen->mask; mask != 0; mask &= mask - 1)
+    {
+        const uint64_t *covering = shared->covers + __builtin_ctzll(mask) * words;
+        for (int w = 0; w < words; w++)
+            to[w] &= ~covering[w];
+    }
+    clear_range(to, header->piece_placements[chosen->piece], header->piece_placements[chosen->piece + 1]);
+}
+
+static void search_dynamic(search_context *context, const uint32_t level, const uint32_t used, const uint64_t board)
+{
+    search_shared *shared = context->shared;
+    const tables_header *header = shared->tables->header;
+    int words = shared->words;
+
+    if (level == header->pieces)
+    {
+        report_solution(context);
+        return;
+    }
+
+    const uint64_t *alive = context->alive + (size_t)level * words;
+    uint64_t *next = context->alive + (size_t)(level + 1) * words;
+
+    // The candidates are the alive placements of the chosen piece or covering the chosen cell
+    uint64_t candidates[words];
+    int fewest = -1;
+    if (shared->options->order == ORDER_PIECE)
+    {
+        uint32_t best = 0;
+        for (uint32_t piece = 0; piece < header->pieces; piece++)
+        {
+            if ((used >> piece) & 1)
+                continue;
+            int count = count_range(alive, header->piece_placements[piece], header->piece_placements[piece + 1]);
+            if (fewest < 0 || count < fewest)
+            {
+                fewest = count;
+                best = piece;
+            }
+            if (count == 0)
+                return;
+        }
+        memset(candidates, 0, sizeof(uint64_t) * words);
+        for (uint32_t p = header->piece_placements[best]; p < header->piece_placements[best + 1]; p++)
+            candidates[p / 64] |= alive[p / 64] & (1ULL << (p % 64));
+    }
+    else
+    {
+        int best = 0;
+        for (uint64_t free_cells = ~board; free_cells != 0; free_cells &= free_cells - 1)
+        {
+            int cell = __builtin_ctzll(free_cells);
+            const uint64_t *covering = shared->covers + cell * words;
+            int count = 0;
+            for (int w = 0; w < words; w++)
+                count += __builtin_popcountll(alive[w] & covering[w]);
+            if (fewest < 0 || count < fewest)
+            {
+                fewest = count;
+                best = cell;
+            }
+            if (count == 0)
+                return;
+        }
+        const uint64_t *covering = shared->covers + best * words;
+        for (int w = 0; w < words; w++)
+            candidates[w] = alive[w] & covering[w];
+    }
+
+    const placement *placements = shared->tables->placements;
+    context->branch[level] = 0;
+    context->branches[level] = fewest;
+    for (int w = 0; w < words; w++)
+        for (uint64_t bits = candidates[w]; bits != 0; bits &= bits - 1, context->branch[level]++)
+        {
+            uint32_t p = w * 64 + __builtin_ctzll(bits);
+
+            context->chosen[placements[p].piece] = p;
+            context->path[level] = p;
+            if (!(++context->result.nodes & (CHECK_NODES - 1)) && shared->checking)
+                check_search(context, level + 1);
+            place_alive(shared, alive, next, p);
+            search_dynamic(context, level + 1, used | 1u << placements[p].piece, board | placements[p].mask);
+
+            if (atomic_load_explicit(&shared->stop, memory_order_relaxed))
+            {
+                if (context->stop_level < 0)
+                    context->stop_level = level + 1;
+                return;
+            }
+        }
+}
+
+static void *search_worker(void *data)
+{
+    search_context *context = (search_context *)data;
+    search_shared *shared = context->shared;
+    const tables_header *header = shared->tables->header;
+    const placement *placements = shared->tables->placements;
+
+    // Workers take the placements of the first piece to place one at a time. Once an ordered search
+    // has found its limit, the branches started hold the first solutions in search order.
+    uint32_t piece = shared->first;
+    uint32_t start = header->piece_placements[piece];
+    uint32_t end = header->piece_placements[piece + 1];
+    uint64_t limit = shared->options->limit;
+    while (!atomic_load_explicit(&shared->stop, memory_order_relaxed))
+    {
+        if (shared->ordered && limit && atomic_load(&shared->found) >= limit)
+            break;
+        uint32_t p = start + atomic_fetch_add(&shared->next_branch, 1);
+        if (p >= end)
+            break;
+        if (shared->board & placements[p].mask)
+            continue;
+
+        context->result.nodes++;
+        context->chosen[piece] = p;
+        if (shared->options->order == ORDER_FIXED)
+            search(context, shared->next[piece], shared->board | placements[p].mask);
+        else
+        {
+            uint32_t level = shared->level;
+            context->path[level] = p;
+            place_alive(shared, context->alive + (size_t)level * shared->words, context->alive + (size_t)(level + 1) * shared->words, p);
+            search_dynamic(context, level + 1, shared->used | 1u << piece, shared->board | placements[p].mask);
+        }
+
+        if (atomic_load_explicit(&shared->stop, memory_order_relaxed))
+            context->in_branch = true;
+        else
+            atomic_fetch_add(&shared->finished_branches, 1);
+    }
+
+    return NULL;
+}
+
+//-------------------------Ordered solutions-------------------------
+
+typedef struct merge_state
+{
+    const search_shared *shared;
+    uint64_t passed;
+    bool stopped;
+} merge_state;
+
+static bool pass_solution(const uint16_t *placements, void *data)
+{
+    merge_state *state = (merge_state *)data;
+    const search_options *options = state->shared->options;
+
+    state->passed++;
+    if (options->on_solution != NULL && !options->on_solution(state->shared->tables, placements, options->data))
+        state->stopped = true;
+    if (options->limit && state->passed == options->limit)
+        state->stopped = true;
+    return !state->stopped;
+}
+
+// Passes the solutions of the runs in search order, up to the limit
+static void merge_runs(const search_shared *shared, solution_run *runs, const int count, search_result *result)
+{
+    merge_state state = {shared, 0, false};
+    bool complete = runs_merge(runs, count, pass_solution, &state) >= 0;
+
+    // The limit was reached, the callback stopped, or solutions were lost by a spill
+    uint64_t limit = shared->options->limit;
+    result->stopped |= state.stopped || (limit && result->solutions >= limit) || !complete;
+    result->solutions = state.passed;
+}
+
+bool engine_check_fixed(const puzzle_tables *tables, const uint64_t board, const search_options *options, const int depth)
+{
+    const placement *placements = tables->placements;
+    uint32_t pieces = 0;
+    uint64_t covered = board;
+    for (int i = 0; i < options->fixed_count; i++)
+    {
+        if (options->fixed[i] >= tables->header->placements)
+        {
+            fprintf(stderr, "Error : there is no placement %u\n", options->fixed[i]);
+            return false;
+        }
+
+        const placement *chosen = placements + options->fixed[i];
+        if ((pieces >> chosen->piece) & 1 || (int)chosen->piece < depth)
+        {
+            fprintf(stderr, "Error : piece %u is placed twice\n", chosen->piece);
+            return false;
+        }
+        if (covered & chosen->mask)
+        {
+            fprintf(stderr, "Error : piece %u overlaps the date or another piece\n", chosen->piece);
+            return false;
+        }
+        pieces |= 1u << chosen->piece;
+        covered |= chosen->mask;
+    }
+    return true;
+}
+
+search_result engine_search(const puzzle_tables *tables, const uint64_t board, const search_options *options)
+{
+    return engine_search_from(tables, board, NULL, 0, options);
+}
+
+search_result engine_search_from(const puzzle_tables *tables, const uint64_t board, const uint16_t *prefix, const int depth, const search_options *options)
+{
+    search_result result = {0, 0, false, false, 0};
+    const tables_header *header = tables->header;
+
+    // Place the prefix first
+    uint64_t start_board = board;
+    for (int i = 0; i < depth; i++)
+    {
+        if (prefix[i] < header->piece_placements[i] || prefix[i] >= header->piece_placements[i + 1] || (start_board & tables->placements[prefix[i]].mask))
+            return result;
+        start_board |= tables->placements[prefix[i]].mask;
+    }
+
+    // Fixed placements are pre-masked on the board, the search skips their pieces
+    uint32_t fixed = 0;
+    for (int i = 0; i < options->fixed_count; i++)
+    {
+        const placement *chosen = tables->placements + options->fixed[i];
+        if (options->fixed[i] >= header->placements || (fixed >> chosen->piece) & 1 || (int)chosen->piece < depth || (start_board & chosen->mask))
+            return result;
+        fixed |= 1u << chosen->piece;
+        start_board |= chosen->mask;
+    }
+
+    search_shared shared;
+    shared.tables = tables;
+    shared.options = options;
+    shared.board = start_board;
+    shared.depth = depth;
+    shared.fixed = fixed;
+    shared.level = depth + __builtin_popcount(fixed);
+    shared.used = ((1u << depth) - 1) | fixed;
+    shared.next[header->pieces] = header->pieces;
+    for (int piece = header->pieces - 1; piece >= 0; piece--)
+        shared.next[piece] = (fixed >> (piece + 1)) & 1 ? shared.next[piece + 1] : piece + 1;
+    shared.first = depth < (int)header->pieces && (fixed >> depth) & 1 ? shared.next[depth] : (uint32_t)depth;
+    atomic_init(&shared.found, 0);
+    atomic_init(&shared.stop, false);
+    atomic_init(&shared.expired, false);
+    atomic_init(&shared.next_branch, 0);
+    atomic_init(&shared.finished_branches, 0);
+    shared.checking = options->on_progress != NULL || options->budget.deadline > 0 || options->budget.cancel != NULL;
+
+    // A budget already spent doesn't start the search
+    if (engine_expired(&options->budget))
+    {
+        result.stopped = result.expired = true;
+        return result;
+    }
+
+    int jobs = options->jobs > 1 && shared.level + 1 < header->pieces ? options->jobs : 1;
+
+    shared.parallel = jobs > 1;
+    shared.ordered = jobs > 1 && options->ordered;
+    shared.start_time = now_nanoseconds();
+    atomic_init(&shared.published_nodes, 0);
+    atomic_init(&shared.last_report, shared.start_time);
+    shared.estimated_nodes = 0;
+    if (options->on_progress != NULL && jobs > 1 && options->order == ORDER_FIXED && fixed == 0)
+    {
+        uint64_t seed = (start_board ^ 0x9E3779B97F4A7C15ULL) | 1;
+        shared.estimated_nodes = engine_estimate(tables, start_board, depth, PROGRESS_SAMPLES, &seed);
+    }
+    shared.words = 0;
+    shared.covers = NULL;
+    if (options->order != ORDER_FIXED)
+        build_covers(&shared);
+
+    search_context *contexts = (search_context *)calloc(jobs, sizeof(search_context));
+    solution_run *runs = shared.ordered ? (solution_run *)calloc(jobs, sizeof(solution_run)) : NULL;
+    for (int i = 0; i < jobs; i++)
+    {
+        contexts[i].shared = &shared;
+        if (shared.ordered)
+        {
+            contexts[i].run = runs + i;
+            run_init(runs + i, header->pieces, header->pieces);
+        }
+        contexts[i].stop_level = -1;
+        if (depth > 0)
+            memcpy(contexts[i].chosen, prefix, sizeof(uint16_t) * depth);
+        for (int f = 0; f < options->fixed_count; f++)
+            contexts[i].chosen[tables->placements[options->fixed[f]].piece] = options->fixed[f];
+        if (options->order != ORDER_FIXED)
+        {
+            contexts[i].alive = (uint64_t *)malloc(sizeof(uint64_t) * shared.words * (header->pieces + 1));
+            initial_alive(&shared, contexts[i].alive + (size_t)shared.level * shared.words);
+        }
+    }
+
+    if (jobs == 1 && options->order == ORDER_FIXED)
+        search(contexts, shared.first, start_board);
+    else if (jobs == 1)
+        search_dynamic(contexts, shared.level, shared.used, start_board);
+    else
+    {
+        pthread_mutex_init(&shared.lock, NULL);
+        pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * jobs);
+        for (int i = 0; i < jobs; i++)
+            pthread_create(threads + i, NULL, search_worker, contexts + i);
+        for (int i = 0; i < jobs; i++)
+            pthread_join(threads[i], NULL);
+        free(threads);
+        pthread_mutex_destroy(&shared.lock);
+    }
+
+    result.stopped = atomic_load(&shared.stop);
+    result.expired = atomic_load(&shared.expired);
+    for (int i = 0; i < jobs; i++)
+    {
+        result.solutions += contexts[i].result.solutions;
+        result.nodes += contexts[i].result.nodes;
+    }
+    if (shared.ordered)
+        merge_runs(&shared, runs, jobs, &result);
+
+    // A parallel search adds the branches of the first piece the workers went through and the
+    // part of the branches they were in
+    if (!result.stopped)
+        result.fraction = 1;
+    else if (jobs == 1)
+        result.fraction = contexts->stop_level >= 0 ? search_fraction(contexts, contexts->stop_level, false) : 0;
+    else
+    {
+        uint32_t branches = 0;
+        for (uint32_t p = header->piece_placements[shared.first]; p < header->piece_placements[shared.first + 1]; p++)
+            branches += !(start_board & tables->placements[p].mask);
+        double done = atomic_load(&shared.finished_branches);
+        for (int i = 0; i < jobs; i++)
+            if (contexts[i].in_branch && contexts[i].stop_level >= 0)
+                done += search_fraction(contexts + i, contexts[i].stop_level, true);
+        result.fraction = branches > 0 ? fmin(done / branches, 1) : 0;
+    }
+
+    for (int i = 0; i < jobs; i++)
+    {
+        free(contexts[i].alive);
+        if (runs != NULL)
+            run_free(runs + i);
+    }
+    free(runs);
+    free(contexts);
+    free(shared.covers);
+
+    return result;
+}
+
+//-------------------------Estimates-------------------------
+
+double engine_fitting_cost(const puzzle_tables *tables, const uint64_t board)
+{
+    const tables_header *header = tables->header;
+    double cost = 0;
+    for (uint32_t piece = 0; piece < header->pieces; piece++)
+    {
+        int fitting = 0;
+        for (uint32_t p = header->piece_placements[piece]; p < header->piece_placements[piece + 1]; p++)
+            if (!(board & tables->placements[p].mask))
+                fitting++;
+        cost += log2(fitting + 1.0);
+    }
+    return cost;
+}
+
+static uint64_t next_random(uint64_t *seed)
+{
+    // xorshift64*, the seed must not be 0
+    *seed ^= *seed >> 12;
+    *seed ^= *seed << 25;
+    *seed ^= *seed >> 27;
+    return *seed * 0x2545F4914F6CDD1DULL;
+}
+
+double engine_estimate(const puzzle_tables *tables, const uint64_t board, const int piece, const int samples, uint64_t *seed)
+{
+    const tables_header *header = tables->header;
+    const placement *placements = tables->placements;
+    double total = 0;
+
+    for (int s = 0; s < samples; s++)
+    {
+        // Random descent, each level counts as many nodes as the product of the branching factors above it
+        uint64_t current = board;
+        double width = 1, size = 1;
+        for (uint32_t i = piece; i < header->pieces; i++)
+        {
+            // Reservoir sampling picks one of the fitting placements in a single pass
+            uint32_t fitting = 0, chosen = 0;
+            for (uint32_t p = header->piece_placements[i]; p < header->piece_placements[i + 1]; p++)
+            {
+                if (current & placements[p].mask)
+                    continue;
+                fitting++;
+                if (next_random(seed) % fitting == 0)
+                    chosen = p;
+            }
+            if (fitting == 0)
+                break;
+
+            width *= fitting;
+            size += width;
+            current |= placements[chosen].mask;
+        }
+        total += size;
+    }
+
+    return samples > 0 ? total / samples : 0;
+}
+
+static int compare_units(const void *a, const void *b)
+{
+    const search_unit *x = (const search_unit *)a, *y = (const search_unit *)b;
+    int depth = x->depth < y->depth ? x->depth : y->depth;
+    for (int i = 0; i < depth; i++)
+        if (x->prefix[i] != y->prefix[i])
+            return x->prefix[i] < y->prefix[i] ? -1 : 1;
+    return x->depth - y->depth;
+}
+
+int engine_split(const puzzle_tables *tables, const uint64_t board, const int count, const int samples, search_unit **units)
+{
+    const tables_header *header = tables->header;
+    const placement *placements = tables->placements;
+
+    // The seed only depends on the board, so the same date is always split the same way
+    uint64_t seed = (board ^ 0x9E3779B97F4A7C15ULL) | 1;
+
+    int capacity = 64, n = 1;
+    search_unit *list = (search_unit *)calloc(capacity, sizeof(search_unit));
+    list[0].board = board;
+    list[0].estimate = engine_estimate(tables, board, 0, samples, &seed);
+
+    // The largest unit is replaced by its children until there are enough units
+    while (n < count)
+    {
+        int largest = -1;
+        for (int i = 0; i < n; i++)
+            if ((uint32_t)list[i].depth + 1 < header->pieces && (largest < 0 || list[i].estimate > list[largest].estimate))
+                largest = i;
+        if (largest < 0)
+            break;
+
+        search_unit parent = list[largest];
+        list[largest] = list[--n];
+
+        int piece = parent.depth;
+        for (uint32_t p = header->piece_placements[piece]; p < header->piece_placements[piece + 1]; p++)
+        {
+            if (parent.board & placements[p].mask)
+                continue;
+            if (n == capacity)
+            {
+                capacity *= 2;
+                list = (search_unit *)realloc(list, sizeof(search_unit) * capacity);
+            }
+            search_unit *child = list + n++;
+            *child = parent;
+            child->prefix[piece] = p;
+            child->depth = piece + 1;
+            child->board = parent.board | placements[p].mask;
+            child->estimate = engine_estimate(tables, child->board, piece + 1, samples, &seed);
+        }
+    }
+
+    // Units come out in search order
+    qsort(list, n, sizeof(search_unit), compare_units);
+    *units = list;
+    return n;
+}
@@ -0,0 +1,133 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "tables.h"
+
+// Called with the placement index chosen for each piece, returning false stops the search.
+// With several jobs the calls are serialized, but come in no particular order unless the search is
+// ordered.
+typedef bool (*solution_callback)(const puzzle_tables *tables, const uint16_t *placements, void *data);
+
+// Progress of a running search, reported every progress_interval seconds
+typedef struct search_progress
+{
+    uint64_t nodes, solutions;
+    double elapsed;
+    double fraction; // Estimated part of the tree already searched, -1 if unknown
+    double eta;      // Estimated seconds left, -1 if unknown
+} search_progress;
+
+typedef void (*progress_callback)(const search_progress *progress, void *data);
+
+// Cancels every search it is given to, from any thread or a signal handler
+typedef struct search_token
+{
+    atomic_bool cancelled;
+} search_token;
+
+// When a search gives up, both are optional
+typedef struct search_budget
+{
+    double deadline; // Seconds on engine_clock(), 0 for none
+    search_token *cancel;
+} search_budget;
+
+// Which piece is placed next
+typedef enum search_order
+{
+    ORDER_FIXED, // Pieces in definition order
+    ORDER_PIECE, // The remaining piece with the fewest legal placements
+    ORDER_CELL   // Every legal placement covering the free cell with the fewest of them
+} search_order;
+
+typedef struct search_options
+{
+    solution_callback on_solution;
+    void *data;
+    uint64_t limit; // Stop after this many solutions, 0 for all of them
+    int jobs;       // Worker threads, the first piece's placements are shared between them
+    search_order order;
+    search_budget budget;
+
+    // With several jobs, solutions are passed to on_solution once the search ends, in the order of
+    // a single job search for the fixed order, and in the same order for any number of jobs for the
+    // dynamic ones (their first piece differs from a single job's). Every worker keeps the
+    // solutions it finds, tagged with their search path, in a run spilled to a temporary file past
+    // RUN_RECORDS of them, and the runs are merged. A limit stops the workers from starting new
+    // branches of the first piece, the branches started are searched to the end.
+    bool ordered;
+
+    // Placements already on the board, from tables_find_placement. The search only places the other
+    // pieces and every solution includes these ones.
+    const uint16_t *fixed;
+    int fixed_count;
+
+    // Checked every CHECK_NODES nodes of a worker, calls are serialized
+    progress_callback on_progress;
+    void *progress_data;
+    double progress_interval;
+} search_options;
+
+// Nodes between two checks of the budget and the progress
+#define CHECK_NODES (1 << 12)
+
+typedef struct search_result
+{
+    uint64_t solutions;
+    uint64_t nodes;
+    bool stopped;    // The limit was reached, the callback asked to stop or the budget ran out
+    bool expired;    // The deadline passed or the search was cancelled, solutions are the ones found so far
+    double fraction; // Estimated part of the tree searched, 1 when the search went through
+} search_result;
+
+// Part of a search, the placements of the first depth pieces. Searching every unit of a split
+// finds every solution of the whole search exactly once.
+typedef struct search_unit
+{
+    int depth;
+    uint16_t prefix[MAX_PIECES];
+    uint64_t board;  // Board once the prefix is placed
+    double estimate; // Sampled subtree size, in nodes
+} search_unit;
+
+void search_options_init(search_options *options);
+
+void search_token_init(search_token *token);
+void search_cancel(search_token *token);
+
+// Monotonic clock in seconds, for deadlines
+double engine_clock();
+
+// Whether a search with this budget must give up now, false for NULL
+bool engine_expired(const search_budget *budget);
+
+// Parses fixed, piece or cell
+bool engine_parse_order(const char *name, search_order *order);
+
+// Depth-first search over the placement tables, pieces in the order of options->order
+search_result engine_search(const puzzle_tables *tables, const uint64_t board, const search_options *options);
+
+// Whether options->fixed can be completed on board : one placement per piece at most, no overlap
+// with each other nor with the board, and no piece of the prefix's depth first ones. Prints why not.
+bool engine_check_fixed(const puzzle_tables *tables, const uint64_t board, const search_options *options, const int depth);
+
+// Same search below a prefix, the placements of the first depth pieces. Nothing is found if they
+// overlap, or if options->fixed doesn't pass engine_check_fixed.
+search_result engine_search_from(const puzzle_tables *tables, const uint64_t board, const uint16_t *prefix, const int depth, const search_options *options);
+
+// Splits the search of board into at least count units of similar estimated size, unless the
+// tree has fewer leaves than that. Returns the number of units, *units is allocated.
+int engine_split(const puzzle_tables *tables, const uint64_t board, const int count, const int samples, search_unit **units);
+
+// Knuth's estimate of the number of nodes below board when piece is the next one to place,
+// averaged over samples random descents. seed is the state of the random generator.
+double engine_estimate(const puzzle_tables *tables, const uint64_t board, const int piece, const int samples, uint64_t *seed);
+
+// Cheap cost estimate, the log2 of the product of each piece's fitting placements counts
+double engine_fitting_cost(const puzzle_tables *tables, const uint64_t board);
+
+#endif
@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "filters.h"
+
+#define COLUMN_0 0x0101010101010101ULL
+#define COLUMN_7 0x8080808080808080ULL
+
+//-------------------------Tables-------------------------
+
+bool filters_init(filter_set *filters, const puzzle_tables *tables, const bool parity, const bool sizes)
+{
+    const tables_header *header = tables->header;
+    uint32_t subsets = 1u << header->pieces;
+
+    memset(filters, 0, sizeof(filter_set));
+    filters->parity = parity;
+    filters->sizes = sizes;
+    filters->pieces = subsets - 1;
+    for (int y = 0; y < 8; y++)
+        for (int x = 0; x < 8; x++)
+            if ((x + y) % 2 == 0)
+                filters->black |= 1ULL << CELL(x, y);
+
+    filters->balances = parity ? (uint8_t *)calloc((size_t)subsets * PARITY_RANGE, 1) : NULL;
+    filters->sums = (uint64_t *)calloc(subsets, sizeof(uint64_t));
+    filters->area = (uint32_t *)calloc(subsets, sizeof(uint32_t));
+    if ((parity && filters->balances == NULL) || filters->sums == NULL || filters->area == NULL)
+    {
+        fprintf(stderr, "Error : cannot allocate the filters tables\n");
+        filters_free(filters);
+        return false;
+    }
+
+    // Colour differences each piece's placements can have
+    uint8_t differences[MAX_PIECES][PARITY_RANGE];
+    memset(differences, 0, sizeof(differences));
+    for (uint32_t p = 0; p < header->placements; p++)
+    {
+        const placement *current = tables->placements + p;
+        int black = __builtin_popcountll(current->mask & filters->black);
+        int white = __builtin_popcountll(current->mask & ~filters->black);
+        differences[current->piece][black - white + PARITY_OFFSET] = 1;
+    }
+
+    // Each set extends the set without its lowest piece
+    filters->sums[0] = 1;
+    if (parity)
+        filters->balances[PARITY_OFFSET] = 1;
+    for (uint32_t set = 1; set < subsets; set++)
+    {
+        int piece = __builtin_ctz(set);
+        uint32_t rest = set & (set - 1);
+        uint32_t size = header->piece_size[piece];
+
+        filters->area[set] = filters->area[rest] + size;
+        filters->sums[set] = filters->sums[rest] | (size < 64 ? filters->sums[rest] << size : 0);
+
+        if (!parity)
+            continue;
+        const uint8_t *from = filters->balances + (size_t)rest * PARITY_RANGE;
+        uint8_t *to = filters->balances + (size_t)set * PARITY_RANGE;
+        for (int d = 0; d < PARITY_RANGE; d++)
+        {
+            if (!differences[piece][d])
+                continue;
+            int shift = d - PARITY_OFFSET;
+            for (int v = 0; v < PARITY_RANGE; v++)
+                if (from[v] && v + shift >= 0 && v + shift < PARITY_RANGE)
+                    to[v + shift] = 1;
+        }
+    }
+
+    return true;
+}
+
+void filters_free(filter_set *filters)
+{
+    free(filters->balances);
+    free(filters->sums);
+    free(filters->area);
+    filters->balances = NULL;
+    filters->sums = NULL;
+    filters->area = NULL;
+}
+
+bool filters_parse(const char *list, bool *parity, bool *sizes)
+{
+    *parity = *sizes = false;
+    if (strcmp(list, "none") == 0)
+        return true;
+    if (strcmp(list, "all") == 0)
+    {
+        *parity = *sizes = true;
+        return true;
+    }
+
+    char names[64];
+    snprintf(names, sizeof(names), "%s", list);
+    for (char *name = strtok(names, ","); name != NULL; name = strtok(NULL, ","))
+    {
+        if (strcmp(name, "parity") == 0)
+            *parity = true;
+        else if (strcmp(name, "sizes") == 0)
+            *sizes = true;
+        else
+        {
+            fprintf(stderr, "Error : unknown filter %s\n", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+//-------------------------Checks-------------------------
+
+static uint64_t fill_region(const uint64_t seed, const uint64_t free_cells)
+{
+    // Grows the region one step in the four directions at a time, rows don't wrap
+    uint64_t region = seed, previous = 0;
+    while (region != previous)
+    {
+        previous = region;
+        region |= (region << 8) | (region >> 8) | ((region << 1) & ~COLUMN_0) | ((region >> 1) & ~COLUMN_7);
+        region &= free_cells;
+    }
+    return region;
+}
+
+bool filters_pass(filter_set *filters, const uint64_t board, const uint32_t used)
+{
+    uint32_t remaining = filters->pieces & ~used;
+    uint64_t free_cells = ~board;
+    filters->checks++;
+
+    if (filters->sizes)
+    {
+        bool fits = (uint32_t)__builtin_popcountll(free_cells) == filters->area[remaining];
+        uint64_t left = free_cells;
+        while (fits && left != 0)
+        {
+            uint64_t region = fill_region(left & -left, left);
+            int size = __builtin_popcountll(region);
+            fits = size < 64 && (filters->sums[remaining] >> size) & 1;
+            left &= ~region;
+        }
+        if (!fits)
+        {
+            filters->size_hits++;
+            return false;
+        }
+    }
+
+    if (filters->parity)
+    {
+        int balance = __builtin_popcountll(free_cells & filters->black) - __builtin_popcountll(free_cells & ~filters->black);
+        if (!filters->balances[(size_t)remaining * PARITY_RANGE + balance + PARITY_OFFSET])
+        {
+            filters->parity_hits++;
+            return false;
+        }
+    }
+
+    return true;
+}
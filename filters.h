@@ -0,0 +1,40 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tables.h"
+
+// Range of the black minus white cells difference of a region, shifted to be an index
+#define PARITY_OFFSET 64
+#define PARITY_RANGE (2 * PARITY_OFFSET + 1)
+
+// Necessary conditions for the remaining pieces to cover the free cells, checked at every node.
+// parity : the free cells' checkerboard imbalance must be a sum of one colour difference per
+// remaining piece, among the differences its placements can have.
+// sizes : the free cells must be as many as the remaining pieces' cells, and every connected
+// region of free cells must be the size of a subset of the remaining pieces.
+typedef struct filter_set
+{
+    bool parity, sizes;
+    uint64_t checks, parity_hits, size_hits;
+
+    uint64_t black;     // Cells where x + y is even
+    uint32_t pieces;    // Bit of every piece
+    uint8_t *balances;  // PARITY_RANGE reachable differences per set of remaining pieces
+    uint64_t *sums;     // Bit s is set if a subset of the remaining pieces has s cells
+    uint32_t *area;     // Cells of the remaining pieces
+} filter_set;
+
+// Filters are precomputed for every set of remaining pieces, so they cost a few lookups per node
+bool filters_init(filter_set *filters, const puzzle_tables *tables, const bool parity, const bool sizes);
+void filters_free(filter_set *filters);
+
+// Parses a comma separated list of filters, "all" or "none"
+bool filters_parse(const char *list, bool *parity, bool *sizes);
+
+// False if the free cells of board can't be covered by the pieces missing from used
+bool filters_pass(filter_set *filters, const uint64_t board, const uint32_t used);
+
+#endif
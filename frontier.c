@@ -0,0 +1,100 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "frontier.h"
+
+typedef struct frontier
+{
+    const puzzle_tables *tables;
+    uint32_t all_pieces;
+    filter_set *filters;
+    state_table states;
+
+    uint64_t nodes;
+
+    // Checked every CHECK_NODES expanded states, the count gives up once it is spent
+    const search_budget *budget;
+    bool expired;
+    uint32_t branch, branches; // Placements of the first cell tried, and fitting
+} frontier;
+
+//-------------------------Count-------------------------
+
+static uint64_t count_states(frontier *f, const uint64_t board, const uint32_t used)
+{
+    uint64_t free_cells = ~board;
+    if (free_cells == 0)
+        return used == f->all_pieces;
+    if (used == f->all_pieces)
+        return 0;
+
+    uint64_t count;
+    if (states_get(&f->states, free_cells, used, &count))
+        return count;
+
+    if (f->filters != NULL && !filters_pass(f->filters, board, used))
+        return 0;
+
+    if (!(++f->nodes & (CHECK_NODES - 1)) && engine_expired(f->budget))
+        f->expired = true;
+    if (f->expired)
+        return 0;
+
+    const tables_header *header = f->tables->header;
+    const placement *placements = f->tables->placements;
+    const uint16_t *anchored = f->tables->anchored;
+
+    // The lowest free cell is covered by a placement starting there
+    int cell = __builtin_ctzll(free_cells);
+    count = 0;
+    for (uint32_t i = header->anchored_start[cell]; i < header->anchored_start[cell + 1]; i++)
+    {
+        const placement *chosen = placements + anchored[i];
+        if ((used >> chosen->piece) & 1 || (board & chosen->mask))
+            continue;
+        f->branch += used == 0;
+        count += count_states(f, board | chosen->mask, used | (1u << chosen->piece));
+    }
+
+    // The count of an interrupted state is only the part found so far, it isn't stored
+    if (!f->expired)
+        states_put(&f->states, free_cells, used, count);
+    return count;
+}
+
+search_result frontier_count(const puzzle_tables *tables, const uint64_t board, const size_t memory, filter_set *filters, const search_budget *budget)
+{
+    search_result result = {0, 0, false, false, 0};
+
+    frontier f;
+    memset(&f, 0, sizeof(f));
+    f.tables = tables;
+    f.all_pieces = (1u << tables->header->pieces) - 1;
+    f.filters = filters;
+    f.budget = budget;
+    if (!states_init(&f.states, memory))
+    {
+        fprintf(stderr, "Error : cannot allocate the states table\n");
+        result.stopped = true;
+        return result;
+    }
+
+    // Only the first cell's placements, the ones without a used piece, are counted as branches
+    int cell = ~board != 0 ? __builtin_ctzll(~board) : 0;
+    for (uint32_t i = tables->header->anchored_start[cell]; i < tables->header->anchored_start[cell + 1] && ~board != 0; i++)
+        f.branches += !(board & tables->placements[tables->anchored[i]].mask);
+
+    result.solutions = count_states(&f, board, 0);
+    result.nodes = f.nodes;
+    result.expired = result.stopped = f.expired;
+    if (!f.expired)
+        result.fraction = 1;
+    else if (f.branches > 0 && f.branch > 0)
+        result.fraction = (double)(f.branch - 1) / f.branches;
+
+    states_free(&f.states);
+    return result;
+}
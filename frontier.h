@@ -0,0 +1,23 @@
+#ifndef FRONTIER_H
+#define FRONTIER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tables.h"
+#include "engine.h"
+#include "filters.h"
+#include "states.h"
+
+// Memory used by the states table when none is given
+#define FRONTIER_DEFAULT_MEMORY ((size_t)256 << 20)
+
+// Frontier dynamic programming count : cells are filled in row-major order, the lowest free cell
+// being covered by a placement whose lowest cell it is. Every cell before it is covered, so a state
+// is the occupancy from that cell on plus the set of used pieces, and the count of each state is
+// kept in a table growing up to memory bytes. Once the table is full, new states are counted without
+// being stored. nodes counts the states which were expanded, filters (or NULL) are checked first.
+// Once budget (or NULL) is spent, the solutions counted so far are returned.
+search_result frontier_count(const puzzle_tables *tables, const uint64_t board, const size_t memory, filter_set *filters, const search_budget *budget);
+
+#endif
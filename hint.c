@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "hint.h"
+
+//-------------------------Table-------------------------
+
+bool hint_init(hint_table *table, const puzzle_tables *tables, const size_t memory, filter_set *filters)
+{
+    memset(table, 0, sizeof(hint_table));
+    table->tables = tables;
+    table->all_pieces = (1u << tables->header->pieces) - 1;
+    table->filters = filters;
+    bool allocated = states_init(&table->states, memory);
+    table->completions = (uint64_t *)calloc(tables->header->placements, sizeof(uint64_t));
+    if (!allocated || table->completions == NULL)
+    {
+        fprintf(stderr, "Error : cannot allocate the hints table\n");
+        hint_free(table);
+        return false;
+    }
+    return true;
+}
+
+void hint_free(hint_table *table)
+{
+    states_free(&table->states);
+    free(table->completions);
+    table->completions = NULL;
+}
+
+//-------------------------Counts-------------------------
+
+// Completions of the state. The lowest free cell is covered by a placement starting there, as in
+// the frontier count, so that the states of different boards meet.
+static uint64_t count_state(hint_table *table, const uint64_t board, const uint32_t used)
+{
+    uint64_t free_cells = ~board;
+    if (free_cells == 0)
+        return used == table->all_pieces;
+    if (used == table->all_pieces)
+        return 0;
+
+    table->lookups++;
+    uint64_t count;
+    if (states_get(&table->states, free_cells, used, &count))
+    {
+        table->hits++;
+        return count;
+    }
+
+    if (table->filters != NULL && !filters_pass(table->filters, board, used))
+        return 0;
+
+    if (!(++table->nodes & (CHECK_NODES - 1)) && engine_expired(table->budget))
+        table->expired = true;
+    if (table->expired)
+        return 0;
+
+    const tables_header *header = table->tables->header;
+    const placement *placements = table->tables->placements;
+    const uint16_t *anchored = table->tables->anchored;
+
+    int cell = __builtin_ctzll(free_cells);
+    count = 0;
+    for (uint32_t i = header->anchored_start[cell]; i < header->anchored_start[cell + 1]; i++)
+    {
+        const placement *chosen = placements + anchored[i];
+        if ((used >> chosen->piece) & 1 || (board & chosen->mask))
+            continue;
+        count += count_state(table, board | chosen->mask, used | (1u << chosen->piece));
+    }
+
+    // The count of an interrupted state is only the part found so far, it isn't stored
+    if (!table->expired)
+        states_put(&table->states, free_cells, used, count);
+    return count;
+}
+
+// Adds the completions below the state to every placement on their paths. The states are reached
+// once per path, which is at most once per completion and depth, and their children are counted.
+static void walk_state(hint_table *table, const uint64_t board, const uint32_t used)
+{
+    if (~board == 0)
+    {
+        table->walked++;
+        return;
+    }
+    if (table->expired)
+        return;
+
+    const tables_header *header = table->tables->header;
+    const placement *placements = table->tables->placements;
+    const uint16_t *anchored = table->tables->anchored;
+
+    int cell = __builtin_ctzll(~board);
+    for (uint32_t i = header->anchored_start[cell]; i < header->anchored_start[cell + 1]; i++)
+    {
+        const placement *chosen = placements + anchored[i];
+        if ((used >> chosen->piece) & 1 || (board & chosen->mask))
+            continue;
+        uint64_t count = count_state(table, board | chosen->mask, used | (1u << chosen->piece));
+        if (count == 0 || table->expired)
+            continue;
+        table->completions[anchored[i]] += count;
+        walk_state(table, board | chosen->mask, used | (1u << chosen->piece));
+    }
+}
+
+//-------------------------Moves-------------------------
+
+search_result hint_moves(hint_table *table, const uint64_t board, const uint32_t used, const search_budget *budget, hint_move *moves)
+{
+    const tables_header *header = table->tables->header;
+    search_result result = {0, 0, false, false, 0};
+    uint64_t nodes = table->nodes;
+    table->budget = budget;
+    table->expired = false;
+    table->walked = 0;
+    memset(table->completions, 0, sizeof(uint64_t) * header->placements);
+
+    // Every completion of the board covers its free cells in row-major order once, whichever order
+    // the placements are put in, so the moves are exactly the placements on the walked paths
+    uint64_t total = count_state(table, board, used);
+    if (total > 0)
+        walk_state(table, board, used);
+
+    for (uint32_t p = 0; p < header->placements; p++)
+        if (table->completions[p] > 0)
+        {
+            moves[result.solutions].placement = p;
+            moves[result.solutions].completions = table->completions[p];
+            result.solutions++;
+        }
+
+    result.nodes = table->nodes - nodes;
+    result.expired = result.stopped = table->expired;
+    result.fraction = table->expired ? (total > 0 ? (double)table->walked / total : 0) : 1;
+    table->budget = NULL;
+    return result;
+}
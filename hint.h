@@ -0,0 +1,54 @@
+#ifndef HINT_H
+#define HINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tables.h"
+#include "engine.h"
+#include "filters.h"
+#include "states.h"
+
+// Memory used by the states table when none is given
+#define HINT_DEFAULT_MEMORY ((size_t)64 << 20)
+
+// Completion counts of the states met by the hints, kept from one request to the next. A state is
+// the free cells plus the set of used pieces, whatever the date and the order the pieces were put
+// in, so moving a piece mostly meets states already counted.
+typedef struct hint_table
+{
+    const puzzle_tables *tables;
+    uint32_t all_pieces;
+    filter_set *filters;
+    state_table states; // Completions of every state
+
+    uint64_t nodes, lookups, hits;
+    uint64_t *completions; // Per placement, during a request
+    uint64_t walked;       // Completions walked through during a request
+
+    // Checked every CHECK_NODES expanded states during a request
+    const search_budget *budget;
+    bool expired;
+} hint_table;
+
+typedef struct hint_move
+{
+    uint16_t placement;
+    uint64_t completions; // Solutions of the board using the move
+} hint_move;
+
+// The table starts small and doubles until it reaches memory bytes, then new states are checked
+// without being stored. filters (or NULL) are checked before expanding a state.
+bool hint_init(hint_table *table, const puzzle_tables *tables, const size_t memory, filter_set *filters);
+void hint_free(hint_table *table);
+
+// Every placement of a piece missing from used, anywhere on the free cells of board, below which the
+// board can still be completed, by piece then placement index, with the completions using it. moves
+// holds one entry per placement of the tables. The board's completions are counted, then their
+// paths are walked through the counted states and every placement on them is a move. The result's
+// solutions is the number of moves, once budget (or NULL) is spent the moves are the ones found so
+// far and fraction the part of the completions walked.
+search_result hint_moves(hint_table *table, const uint64_t board, const uint32_t used, const search_budget *budget, hint_move *moves);
+
+#endif
@@ -0,0 +1,365 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "mitm.h"
+
+// Open addressing table from a covered cells mask to its number of packings, 0 is the empty key
+typedef struct packing_table
+{
+    uint64_t *keys;
+    uint64_t *counts;
+    uint64_t size_mask;
+    uint64_t entries, max_entries;
+} packing_table;
+
+// One half of the pieces, enumerated depth first
+typedef struct half_walk
+{
+    const puzzle_tables *tables;
+    int pieces[MAX_PIECES];
+    int count;
+
+    uint64_t free_area;
+    uint32_t used[MAX_PIECES + 1]; // Pieces placed before each depth
+    filter_set *filters;
+    uint32_t pass, passes;
+    packing_table *table; // Filled by the first half
+    bool full;            // The table ran out of room during this pass
+
+    uint64_t found; // Pairs counted by the second half
+    uint64_t nodes;
+
+    // Checked every CHECK_NODES calls, the walk gives up once it is spent
+    const search_budget *budget;
+    uint64_t visits;
+    bool expired;
+    uint32_t branch, branches; // Placements of the walk's first piece tried, and fitting
+} half_walk;
+
+//-------------------------Table-------------------------
+
+static uint64_t mix(uint64_t key)
+{
+    // splitmix64 finalizer
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    key ^= key >> 31;
+    return key;
+}
+
+static bool table_init(packing_table *table, const size_t memory)
+{
+    // Half full at most, so that probes stay short
+    uint64_t slots = 1024;
+    while (slots * 2 * 2 * sizeof(uint64_t) <= memory)
+        slots *= 2;
+
+    table->keys = (uint64_t *)calloc(slots, sizeof(uint64_t));
+    table->counts = (uint64_t *)malloc(slots * sizeof(uint64_t));
+    if (table->keys == NULL || table->counts == NULL)
+    {
+        free(table->keys);
+        free(table->counts);
+        return false;
+    }
+    table->size_mask = slots - 1;
+    table->entries = 0;
+    table->max_entries = slots / 2;
+    return true;
+}
+
+static void table_clear(packing_table *table)
+{
+    memset(table->keys, 0, (table->size_mask + 1) * sizeof(uint64_t));
+    table->entries = 0;
+}
+
+static bool table_add(packing_table *table, const uint64_t key, const uint64_t hash)
+{
+    uint64_t i = hash & table->size_mask;
+    while (table->keys[i] != 0)
+    {
+        if (table->keys[i] == key)
+        {
+            table->counts[i]++;
+            return true;
+        }
+        i = (i + 1) & table->size_mask;
+    }
+
+    if (table->entries == table->max_entries)
+        return false;
+    table->keys[i] = key;
+    table->counts[i] = 1;
+    table->entries++;
+    return true;
+}
+
+static uint64_t table_get(const packing_table *table, const uint64_t key, const uint64_t hash)
+{
+    uint64_t i = hash & table->size_mask;
+    while (table->keys[i] != 0)
+    {
+        if (table->keys[i] == key)
+            return table->counts[i];
+        i = (i + 1) & table->size_mask;
+    }
+    return 0;
+}
+
+//-------------------------Halves-------------------------
+
+static bool walk_expired(half_walk *walk)
+{
+    if (walk->budget != NULL && !(++walk->visits & (CHECK_NODES - 1)) && engine_expired(walk->budget))
+        walk->expired = true;
+    return walk->expired;
+}
+
+static bool in_pass(const half_walk *walk, const uint64_t hash)
+{
+    // The high bits choose the pass, the low ones the slot
+    return walk->passes == 1 || (uint32_t)((hash >> 40) % walk->passes) == walk->pass;
+}
+
+static void store_packings(half_walk *walk, const int depth, const uint64_t covered)
+{
+    if (walk->full || walk_expired(walk))
+        return;
+    if (walk->filters != NULL && depth > 0 && !filters_pass(walk->filters, ~walk->free_area | covered, walk->used[depth]))
+        return;
+
+    if (depth == walk->count)
+    {
+        walk->nodes++;
+        uint64_t hash = mix(covered);
+        if (in_pass(walk, hash) && !table_add(walk->table, covered, hash))
+            walk->full = true;
+        return;
+    }
+
+    const tables_header *header = walk->tables->header;
+    const placement *placements = walk->tables->placements;
+    int piece = walk->pieces[depth];
+    uint64_t board = ~walk->free_area | covered;
+    for (uint32_t p = header->piece_placements[piece]; p < header->piece_placements[piece + 1]; p++)
+        if (!(board & placements[p].mask))
+        {
+            walk->branch += depth == 0;
+            store_packings(walk, depth + 1, covered | placements[p].mask);
+        }
+}
+
+static void match_packings(half_walk *walk, const int depth, const uint64_t covered)
+{
+    if (walk_expired(walk))
+        return;
+    if (walk->filters != NULL && !filters_pass(walk->filters, ~walk->free_area | covered, walk->used[depth]))
+        return;
+    if (depth == walk->count)
+    {
+        walk->nodes++;
+        uint64_t complement = walk->free_area & ~covered;
+        uint64_t hash = mix(complement);
+        if (in_pass(walk, hash))
+            walk->found += table_get(walk->table, complement, hash);
+        return;
+    }
+
+    const tables_header *header = walk->tables->header;
+    const placement *placements = walk->tables->placements;
+    int piece = walk->pieces[depth];
+    uint64_t board = ~walk->free_area | covered;
+    for (uint32_t p = header->piece_placements[piece]; p < header->piece_placements[piece + 1]; p++)
+        if (!(board & placements[p].mask))
+        {
+            walk->branch += depth == 0;
+            match_packings(walk, depth + 1, covered | placements[p].mask);
+        }
+}
+
+static double walk_fraction(const half_walk *walk)
+{
+    // The branches before the current one of the first piece
+    return walk->branches > 0 && walk->branch > 0 ? (double)(walk->branch - 1) / walk->branches : 0;
+}
+
+static int half_pieces(const puzzle_tables *tables, const uint32_t half, const bool inside, int *pieces)
+{
+    int count = 0;
+    for (uint32_t piece = 0; piece < tables->header->pieces; piece++)
+        if (((half >> piece) & 1) == inside)
+            pieces[count++] = piece;
+    return count;
+}
+
+//-------------------------Split-------------------------
+
+static uint64_t next_random(uint64_t *seed)
+{
+    // xorshift64*, the seed must not be 0
+    *seed ^= *seed >> 12;
+    *seed ^= *seed << 25;
+    *seed ^= *seed >> 27;
+    return *seed * 0x2545F4914F6CDD1DULL;
+}
+
+static double estimate_packings(const puzzle_tables *tables, const uint64_t board, const int *pieces, const int count, const int samples, uint64_t *seed)
+{
+    const tables_header *header = tables->header;
+    const placement *placements = tables->placements;
+    double total = 0;
+
+    // Knuth's estimator restricted to the leaves, a dead end counts for no packing
+    for (int s = 0; s < samples; s++)
+    {
+        uint64_t current = board;
+        double width = 1;
+        for (int i = 0; i < count && width > 0; i++)
+        {
+            uint32_t fitting = 0, chosen = 0;
+            for (uint32_t p = header->piece_placements[pieces[i]]; p < header->piece_placements[pieces[i] + 1]; p++)
+            {
+                if (current & placements[p].mask)
+                    continue;
+                fitting++;
+                if (next_random(seed) % fitting == 0)
+                    chosen = p;
+            }
+            width *= fitting;
+            current |= placements[chosen].mask;
+        }
+        total += width;
+    }
+
+    return samples > 0 ? total / samples : 0;
+}
+
+uint32_t mitm_split(const puzzle_tables *tables, const uint64_t board, const int samples)
+{
+    uint32_t n = tables->header->pieces;
+    uint32_t best = 0;
+    double best_cost = INFINITY;
+    uint64_t seed = (board ^ 0x9E3779B97F4A7C15ULL) | 1;
+
+    // Halves of n / 2 pieces, the first piece always stays in the first half since swapping the
+    // halves only swaps which one is stored
+    for (uint32_t half = 1; half < (1u << n); half += 2)
+    {
+        if ((uint32_t)__builtin_popcount(half) != n / 2)
+            continue;
+
+        int first[MAX_PIECES], second[MAX_PIECES];
+        int first_count = half_pieces(tables, half, true, first);
+        int second_count = half_pieces(tables, half, false, second);
+        double a = estimate_packings(tables, board, first, first_count, samples, &seed);
+        double b = estimate_packings(tables, board, second, second_count, samples, &seed);
+
+        // Both halves are enumerated once, the smaller one is stored
+        double cost = a + b;
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            best = a <= b ? half : ((1u << n) - 1) & ~half;
+        }
+    }
+
+    return best;
+}
+
+//-------------------------Count-------------------------
+
+search_result mitm_count(const puzzle_tables *tables, const uint64_t board, const uint32_t half, const size_t memory, filter_set *filters, const search_budget *budget)
+{
+    search_result result = {0, 0, false, false, 0};
+
+    half_walk first, second;
+    memset(&first, 0, sizeof(first));
+    memset(&second, 0, sizeof(second));
+    first.tables = second.tables = tables;
+    first.count = half_pieces(tables, half, true, first.pieces);
+    second.count = half_pieces(tables, half, false, second.pieces);
+    first.free_area = second.free_area = ~board;
+    first.filters = second.filters = filters;
+    first.budget = second.budget = budget;
+
+    // Each half is enumerated on its own, the other half's pieces remain to be placed
+    for (int d = 0; d < first.count; d++)
+        first.used[d + 1] = first.used[d] | 1u << first.pieces[d];
+    for (int d = 0; d < second.count; d++)
+        second.used[d + 1] = second.used[d] | 1u << second.pieces[d];
+
+    if (first.count == 0 || second.count == 0)
+    {
+        fprintf(stderr, "Error : both halves need at least one piece\n");
+        result.stopped = true;
+        return result;
+    }
+
+    packing_table table;
+    if (!table_init(&table, memory))
+    {
+        fprintf(stderr, "Error : cannot allocate the packings table\n");
+        result.stopped = true;
+        return result;
+    }
+    first.table = second.table = &table;
+
+    const placement *placements = tables->placements;
+    for (uint32_t p = tables->header->piece_placements[first.pieces[0]]; p < tables->header->piece_placements[first.pieces[0] + 1]; p++)
+        first.branches += !(board & placements[p].mask);
+    for (uint32_t p = tables->header->piece_placements[second.pieces[0]]; p < tables->header->piece_placements[second.pieces[0] + 1]; p++)
+        second.branches += !(board & placements[p].mask);
+
+    // A pass which overflows the table is restarted with twice as many passes
+    uint32_t passes = 1, pass = 0;
+    bool clear = false; // The table comes zeroed from calloc
+    while (pass < passes && !engine_expired(budget))
+    {
+        if (clear)
+            table_clear(&table);
+        clear = true;
+        first.pass = second.pass = pass;
+        first.passes = second.passes = passes;
+        first.full = false;
+        first.branch = second.branch = 0;
+        store_packings(&first, 0, 0);
+        if (first.expired)
+            break;
+
+        if (first.full)
+        {
+            passes *= 2;
+            pass = 0;
+            second.found = 0;
+            continue;
+        }
+        match_packings(&second, 0, 0);
+        if (second.expired)
+            break;
+        pass++;
+    }
+
+    // Pairs already matched are solutions, each pass is about as much storing as matching
+    result.solutions = second.found;
+    result.nodes = first.nodes + second.nodes;
+    result.expired = result.stopped = pass < passes;
+    if (!result.expired)
+        result.fraction = 1;
+    else if (first.expired)
+        result.fraction = (pass + walk_fraction(&first) / 2) / passes;
+    else if (second.expired)
+        result.fraction = (pass + 0.5 + walk_fraction(&second) / 2) / passes;
+    else
+        result.fraction = (double)pass / passes;
+
+    free(table.keys);
+    free(table.counts);
+    return result;
+}
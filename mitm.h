@@ -0,0 +1,27 @@
+#ifndef MITM_H
+#define MITM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tables.h"
+#include "engine.h"
+#include "filters.h"
+
+// Memory used by the packings table when none is given
+#define MITM_DEFAULT_MEMORY ((size_t)256 << 20)
+#define MITM_SAMPLES 32
+
+// Chooses the pieces of the first half, as a bit per piece, so that both halves have about as many
+// packings on board. Packings counts are estimated with samples random descents per half.
+uint32_t mitm_split(const puzzle_tables *tables, const uint64_t board, const int samples);
+
+// Meet in the middle count : every packing of the first half on board is stored by its covered
+// cells, then every packing of the other half looks up the exact complement of its cells in the
+// free area. When the table doesn't fit in memory bytes, the packings are handled in several
+// passes, each one keeping the masks of a share of the hashes. nodes counts the packings.
+// filters, if not NULL, prune the partial packings of both halves. Once budget (or NULL) is spent,
+// the pairs matched so far are returned.
+search_result mitm_count(const puzzle_tables *tables, const uint64_t board, const uint32_t half, const size_t memory, filter_set *filters, const search_budget *budget);
+
+#endif
@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "output.h"
+
+static const char piece_labels[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+bool output_parse_format(const char *name, output_format *format)
+{
+    static const char *names[] = {"text", "grid", "binary", "ndjson"};
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++)
+        if (strcmp(name, names[i]) == 0)
+        {
+            *format = (output_format)i;
+            return true;
+        }
+    fprintf(stderr, "Error : unknown output format %s\n", name);
+    return false;
+}
+
+//-------------------------Writing-------------------------
+
+static bool write_segments(solution_writer *writer)
+{
+    struct iovec iov[OUTPUT_SEGMENTS];
+    int count = 0;
+    for (int s = 0; s <= writer->segment && s < OUTPUT_SEGMENTS; s++)
+        if (writer->lengths[s] > 0)
+        {
+            iov[count].iov_base = writer->buffer + (size_t)s * OUTPUT_SEGMENT_SIZE;
+            iov[count++].iov_len = writer->lengths[s];
+        }
+
+    // Partial writes resume from the first byte left
+    int first = 0;
+    while (first < count && !writer->failed)
+    {
+        ssize_t written = writev(writer->fd, iov + first, count - first);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "Error : cannot write the solutions : %s\n", strerror(errno));
+            writer->failed = true;
+            break;
+        }
+        writer->bytes += written;
+        while (first < count && (size_t)written >= iov[first].iov_len)
+            written -= iov[first++].iov_len;
+        if (first < count)
+        {
+            iov[first].iov_base = (char *)iov[first].iov_base + written;
+            iov[first].iov_len -= written;
+        }
+    }
+
+    memset(writer->lengths, 0, sizeof(writer->lengths));
+    writer->segment = 0;
+    return !writer->failed;
+}
+
+static char *reserve(solution_writer *writer)
+{
+    // The record goes to the next segment if it may not fit, once they are all used they are written
+    if (writer->lengths[writer->segment] + writer->record_size > OUTPUT_SEGMENT_SIZE)
+    {
+        writer->segment++;
+        if (writer->segment == OUTPUT_SEGMENTS)
+            write_segments(writer);
+    }
+    return writer->buffer + (size_t)writer->segment * OUTPUT_SEGMENT_SIZE + writer->lengths[writer->segment];
+}
+
+static void commit(solution_writer *writer, const char *end)
+{
+    writer->lengths[writer->segment] = end - (writer->buffer + (size_t)writer->segment * OUTPUT_SEGMENT_SIZE);
+}
+
+//-------------------------Rendering-------------------------
+
+static char *put_uint(char *out, uint64_t value)
+{
+    char digits[20];
+    int n = 0;
+    do
+    {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    while (n > 0)
+        *out++ = digits[--n];
+    return out;
+}
+
+static char *put_string(char *out, const char *string, const size_t length)
+{
+    memcpy(out, string, length);
+    return out + length;
+}
+
+static char *put_little_endian(char *out, uint64_t value, const int bytes)
+{
+    for (int i = 0; i < bytes; i++, value >>= 8)
+        *out++ = (char)(value & 0xFF);
+    return out;
+}
+
+#define PUT_LITERAL(out, literal) put_string(out, literal, sizeof(literal) - 1)
+
+static char *render_text(const solution_writer *writer, char *out, const uint16_t *placements)
+{
+    const tables_header *header = writer->tables->header;
+
+    // The last placed piece comes first
+    out = PUT_LITERAL(out, "---------Solution ");
+    out = put_uint(out, writer->solutions + 1);
+    out = PUT_LITERAL(out, "---------\n");
+    for (int i = header->pieces - 1; i >= 0; i--)
+    {
+        const placement *chosen = writer->tables->placements + placements[i];
+        out = PUT_LITERAL(out, "\nPosition : (");
+        out = put_uint(out, chosen->x);
+        out = PUT_LITERAL(out, ", ");
+        out = put_uint(out, chosen->y);
+        out = PUT_LITERAL(out, ")\n");
+        out = put_string(out, writer->variant_rows[chosen->variant], writer->variant_lengths[chosen->variant]);
+    }
+    *out++ = '\n';
+    return out;
+}
+
+static char *render_grid(const solution_writer *writer, char *out, const uint16_t *placements)
+{
+    memcpy(out, writer->grid, writer->grid_size);
+    for (uint32_t i = 0; i < writer->tables->header->pieces; i++)
+    {
+        const placement *chosen = writer->tables->placements + placements[i];
+        for (uint64_t cells = chosen->mask; cells != 0; cells &= cells - 1)
+            out[writer->offsets[__builtin_ctzll(cells)]] = piece_labels[chosen->piece];
+    }
+    return out + writer->grid_size;
+}
+
+static char *render_binary(const solution_writer *writer, char *out, const uint16_t *placements)
+{
+    for (uint32_t i = 0; i < writer->tables->header->pieces; i++)
+        out = put_little_endian(out, placements[i], 2);
+    return out;
+}
+
+static char *render_ndjson(const solution_writer *writer, char *out, const uint16_t *placements)
+{
+    const tables_header *header = writer->tables->header;
+
+    // {"solution":1,"pieces":[[0,0,4,0],...]}, variants counted from the piece's first one
+    out = PUT_LITERAL(out, "{\"solution\":");
+    out = put_uint(out, writer->solutions + 1);
+    out = PUT_LITERAL(out, ",\"pieces\":[");
+    for (uint32_t i = 0; i < header->pieces; i++)
+    {
+        const placement *chosen = writer->tables->placements + placements[i];
+        if (i > 0)
+            *out++ = ',';
+        *out++ = '[';
+        out = put_uint(out, chosen->piece);
+        *out++ = ',';
+        out = put_uint(out, chosen->variant - header->piece_variants[chosen->piece]);
+        *out++ = ',';
+        out = put_uint(out, chosen->x);
+        *out++ = ',';
+        out = put_uint(out, chosen->y);
+        *out++ = ']';
+    }
+    out = PUT_LITERAL(out, "]}\n");
+    return out;
+}
+
+//-------------------------Writer-------------------------
+
+bool output_open(solution_writer *writer, const puzzle_tables *tables, const output_format format, const int fd)
+{
+    const tables_header *header = tables->header;
+
+    memset(writer, 0, sizeof(solution_writer));
+    writer->tables = tables;
+    writer->format = format;
+    writer->fd = fd;
+    writer->buffer = (char *)malloc((size_t)OUTPUT_SEGMENT_SIZE * OUTPUT_SEGMENTS);
+    if (writer->buffer == NULL)
+    {
+        fprintf(stderr, "Error : cannot allocate the output buffer\n");
+        return false;
+    }
+
+    // Board rows with a newline each and a blank line after the board, every cell in it is
+    // covered by a piece but the date's ones
+    char *grid = writer->grid;
+    for (uint32_t y = 0; y < header->height; y++)
+    {
+        for (uint32_t x = 0; x < header->width; x++)
+        {
+            writer->offsets[CELL(x, y)] = grid - writer->grid;
+            *grid++ = header->blocked & (1ULL << CELL(x, y)) ? '#' : '.';
+        }
+        *grid++ = '\n';
+    }
+    *grid++ = '\n';
+    writer->grid_size = grid - writer->grid;
+
+    // Bounds of a solution in each format, the text one being rows of "1 " or ". " and a newline
+    switch (format)
+    {
+    case OUTPUT_TEXT:
+        writer->record_size = 64 + header->pieces * (32 + 8 * (8 * 2 + 1));
+        writer->variant_rows = (char **)calloc(header->variants, sizeof(char *));
+        writer->variant_lengths = (uint32_t *)calloc(header->variants, sizeof(uint32_t));
+        for (uint32_t v = 0; v < header->variants; v++)
+        {
+            const variant_entry *variant = tables->variants + v;
+            char *rows = writer->variant_rows[v] = (char *)malloc(variant->height * (variant->width * 2 + 1));
+            for (int i = 0; i < variant->height; i++)
+            {
+                for (int j = 0; j < variant->width; j++)
+                {
+                    *rows++ = variant->rows[i] & (1U << j) ? '1' : '.';
+                    *rows++ = ' ';
+                }
+                *rows++ = '\n';
+            }
+            writer->variant_lengths[v] = rows - writer->variant_rows[v];
+        }
+        break;
+    case OUTPUT_GRID:
+        writer->record_size = writer->grid_size;
+        break;
+    case OUTPUT_BINARY:
+        writer->record_size = 2 * header->pieces;
+        break;
+    case OUTPUT_NDJSON:
+        writer->record_size = 64 + header->pieces * 24;
+        break;
+    }
+
+    if (format == OUTPUT_BINARY)
+    {
+        char *out = put_string(writer->buffer, OUTPUT_MAGIC, 4);
+        out = put_little_endian(out, header->pieces, 4);
+        out = put_little_endian(out, header->hash, 8);
+        writer->lengths[0] = out - writer->buffer;
+    }
+
+    return true;
+}
+
+void output_solution(solution_writer *writer, const uint16_t *placements)
+{
+    char *out = reserve(writer);
+    switch (writer->format)
+    {
+    case OUTPUT_TEXT:
+        out = render_text(writer, out, placements);
+        break;
+    case OUTPUT_GRID:
+        out = render_grid(writer, out, placements);
+        break;
+    case OUTPUT_BINARY:
+        out = render_binary(writer, out, placements);
+        break;
+    case OUTPUT_NDJSON:
+        out = render_ndjson(writer, out, placements);
+        break;
+    }
+    commit(writer, out);
+    writer->solutions++;
+}
+
+bool output_flush(solution_writer *writer)
+{
+    return write_segments(writer);
+}
+
+bool output_close(solution_writer *writer)
+{
+    bool ok = output_flush(writer);
+
+    if (writer->variant_rows != NULL)
+        for (uint32_t v = 0; v < writer->tables->header->variants; v++)
+            free(writer->variant_rows[v]);
+    free(writer->variant_rows);
+    free(writer->variant_lengths);
+    free(writer->buffer);
+    writer->buffer = NULL;
+    return ok;
+}
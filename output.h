@@ -0,0 +1,62 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tables.h"
+
+// Solutions are rendered into segments of a buffer allocated once, a record never straddles two of
+// them, and all the segments are written by a single writev once they are full
+#define OUTPUT_SEGMENT_SIZE (64 << 10)
+#define OUTPUT_SEGMENTS 16
+
+#define OUTPUT_MAGIC "PZS1"
+
+typedef enum output_format
+{
+    OUTPUT_TEXT,   // Every piece's position and rows, as print_solution used to print them
+    OUTPUT_GRID,   // The board, every cell labelled with the id of the piece covering it
+    OUTPUT_BINARY, // A header, then one little endian uint16 placement index per piece
+    OUTPUT_NDJSON  // One JSON object per line with the piece, variant, x and y of every piece
+} output_format;
+
+typedef struct solution_writer
+{
+    const puzzle_tables *tables;
+    output_format format;
+    int fd;
+
+    char *buffer;
+    uint32_t lengths[OUTPUT_SEGMENTS];
+    int segment; // The segment being filled
+    uint32_t record_size; // Bound of one rendered solution
+
+    // Grid format : the empty board, and where each cell goes in it
+    char grid[80];
+    uint32_t grid_size;
+    uint8_t offsets[64];
+
+    // Text format : the rows of every variant, rendered once
+    char **variant_rows;
+    uint32_t *variant_lengths;
+
+    uint64_t solutions, bytes;
+    bool failed;
+} solution_writer;
+
+// Parses text, grid, binary or ndjson
+bool output_parse_format(const char *name, output_format *format);
+
+// Solutions are written to fd. The binary format starts with OUTPUT_MAGIC, the number of pieces as
+// a little endian uint32 and the tables' hash as a uint64, since placement indexes depend on them.
+bool output_open(solution_writer *writer, const puzzle_tables *tables, const output_format format, const int fd);
+
+// Renders one solution, the placement index of every piece, writing the buffer once it is full
+void output_solution(solution_writer *writer, const uint16_t *placements);
+
+// Writes what is buffered, false if a write failed since the writer was opened
+bool output_flush(solution_writer *writer);
+bool output_close(solution_writer *writer);
+
+#endif
@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "profile.h"
+
+#define LINE_LENGTH 256
+
+void profile_identity(const puzzle_tables *tables, order_profile *profile)
+{
+    const tables_header *header = tables->header;
+
+    memset(profile, 0, sizeof(order_profile));
+    profile->hash = header->hash;
+    profile->pieces = header->pieces;
+    for (uint32_t i = 0; i < header->pieces; i++)
+    {
+        profile->piece_order[i] = i;
+        profile->variant_count[i] = header->piece_variants[i + 1] - header->piece_variants[i];
+        for (int v = 0; v < profile->variant_count[i]; v++)
+            profile->variant_order[i][v] = v;
+    }
+}
+
+//-------------------------Files-------------------------
+
+bool profile_read(const char *path, order_profile *profile)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return false;
+
+    memset(profile, 0, sizeof(order_profile));
+    char line[LINE_LENGTH];
+    bool valid = true, has_hash = false;
+    while (valid && fgets(line, LINE_LENGTH, fp) != NULL)
+    {
+        if (line[strspn(line, " \t\r\n")] == '\0' || line[0] == '#')
+            continue;
+
+        unsigned long long hash;
+        int piece, offset;
+        if (sscanf(line, "hash %llx", &hash) == 1)
+        {
+            profile->hash = hash;
+            has_hash = true;
+        }
+        else if (sscanf(line, "piece %d%n", &piece, &offset) == 1 && piece >= 0 && piece < MAX_PIECES && profile->pieces < MAX_PIECES)
+        {
+            uint32_t i = profile->pieces++;
+            profile->piece_order[i] = piece;
+
+            const char *rest = line + offset;
+            int variant, n;
+            while (sscanf(rest, "%d%n", &variant, &n) == 1)
+            {
+                valid = valid && variant >= 0 && variant < MAX_PIECE_VARIANTS && profile->variant_count[i] < MAX_PIECE_VARIANTS;
+                if (valid)
+                    profile->variant_order[i][profile->variant_count[i]++] = variant;
+                rest += n;
+            }
+        }
+        else
+            valid = false;
+    }
+    fclose(fp);
+
+    if (!valid || !has_hash)
+        fprintf(stderr, "Warning : %s isn't a valid profile, it is ignored\n", path);
+    return valid && has_hash;
+}
+
+bool profile_write(const char *path, const order_profile *profile, const char *comment)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error : cannot write %s\n", path);
+        return false;
+    }
+
+    if (comment != NULL)
+        fprintf(fp, "# %s\n", comment);
+    fprintf(fp, "# piece <definition index> <variants in trying order>\n");
+    fprintf(fp, "hash %016llx\n", (unsigned long long)profile->hash);
+    for (uint32_t i = 0; i < profile->pieces; i++)
+    {
+        fprintf(fp, "piece %u", profile->piece_order[i]);
+        for (int v = 0; v < profile->variant_count[i]; v++)
+            fprintf(fp, " %u", profile->variant_order[i][v]);
+        fprintf(fp, "\n");
+    }
+
+    fclose(fp);
+    return true;
+}
+
+//-------------------------Tables-------------------------
+
+puzzle_tables *profile_tables(const puzzle_tables *tables, const order_profile *profile)
+{
+    const tables_header *header = tables->header;
+    if (profile->hash != header->hash || profile->pieces != header->pieces)
+        return NULL;
+
+    // Every piece and every variant of each piece exactly once
+    uint16_t variant_order[MAX_PIECES * MAX_PIECE_VARIANTS];
+    uint32_t seen = 0, v = 0;
+    for (uint32_t i = 0; i < profile->pieces; i++)
+    {
+        uint32_t piece = profile->piece_order[i];
+        uint32_t count = header->piece_variants[piece + 1] - header->piece_variants[piece];
+        if (piece >= header->pieces || (seen >> piece) & 1 || profile->variant_count[i] != count)
+            return NULL;
+        seen |= 1u << piece;
+
+        uint32_t variants_seen = 0;
+        for (uint32_t j = 0; j < count; j++)
+        {
+            uint32_t local = profile->variant_order[i][j];
+            if (local >= count || (variants_seen >> local) & 1)
+                return NULL;
+            variants_seen |= 1u << local;
+            variant_order[v++] = header->piece_variants[piece] + local;
+        }
+    }
+
+    return tables_reorder(tables, profile->piece_order, variant_order);
+}
+
+puzzle_tables *profile_apply(puzzle_tables *tables)
+{
+    const char *path = getenv("PUZZLE_PROFILE");
+    if (path == NULL)
+        path = PROFILE_FILE;
+    if (*path == '\0' || strcmp(path, "off") == 0)
+        return tables;
+
+    order_profile profile;
+    if (!profile_read(path, &profile))
+        return tables;
+
+    puzzle_tables *reordered = profile_tables(tables, &profile);
+    if (reordered == NULL)
+    {
+        fprintf(stderr, "Warning : %s was tuned for another puzzle, run ./tune again\n", path);
+        return tables;
+    }
+
+    tables_free(tables);
+    return reordered;
+}
@@ -0,0 +1,40 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tables.h"
+
+// The tuned order is read from PROFILE_FILE, the file can be changed with the
+// PUZZLE_PROFILE environment variable ("off" keeps the definition order)
+#define PROFILE_FILE "puzzle.profile"
+#define MAX_PIECE_VARIANTS 8
+
+typedef struct order_profile
+{
+    uint64_t hash; // Hash of the tables in definition order the profile was tuned for
+    uint32_t pieces;
+    uint8_t piece_order[MAX_PIECES]; // Definition index of each piece, in search order
+
+    // Per piece in search order, the variants' indexes within the piece in trying order
+    uint8_t variant_count[MAX_PIECES];
+    uint8_t variant_order[MAX_PIECES][MAX_PIECE_VARIANTS];
+} order_profile;
+
+// Definition order
+void profile_identity(const puzzle_tables *tables, order_profile *profile);
+
+// Reading and writing, the file is text : "hash", then one "piece" line per piece in search order
+// with its definition index and its variants' indexes in trying order
+bool profile_read(const char *path, order_profile *profile);
+bool profile_write(const char *path, const order_profile *profile, const char *comment);
+
+// Copy of tables in the profile's order, NULL if the profile doesn't fit them
+puzzle_tables *profile_tables(const puzzle_tables *tables, const order_profile *profile);
+
+// Returns the tables in the order of the profile file when there is one tuned for them, freeing the
+// given tables, or the given tables otherwise
+puzzle_tables *profile_apply(puzzle_tables *tables);
+
+#endif
@@ -0,0 +1,241 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "puzzle.h"
+
+//--------------------Pre-checks--------------------
+
+int count_full_spots(const shapes *shape)
+{
+    int v = 0;
+
+    uint8_t *mask = shape->mask;
+    for (int i = 0; i < shape->height; i++)
+        for (int j = 0; j < shape->width; j++)
+            if (*(mask + i) & (1ULL << j))
+                v++;
+
+    return v;
+}
+
+//-------------------------Memory freeing-------------------------
+
+void free_shapes(shapes *shape)
+{
+    free(shape->mask);
+    free(shape);
+}
+
+void free_all_shapes(shapes *shape)
+{
+    shapes *temp;
+    while (shape != NULL)
+    {
+        temp = shape;
+        shape = shape->next;
+        free_shapes(temp);
+    }
+}
+
+void free_list(shapes_list *list)
+{
+    shapes_list *temp;
+    while (list != NULL)
+    {
+        temp = list;
+        list = list->next;
+        free_all_shapes(temp->shapes);
+        free(temp);
+    }
+}
+
+//-------------------------Shape Generation-------------------------
+
+bool shapes_equal(const shapes *shape_1, const shapes *shape_2)
+{
+    // Start by comparing the sizes
+    if ((shape_1->width != shape_2->width) || (shape_1->height != shape_2->height))
+        return false;
+
+    uint8_t *mask_1 = shape_1->mask;
+    uint8_t *mask_2 = shape_2->mask;
+
+    // Then compare the contents
+    for (int i = 0; i < shape_1->height; i++)
+    {
+        if (*(mask_1 + i) != *(mask_2 + i))
+            return false;
+    }
+
+    return true;
+}
+
+bool shape_equal_in_list(const shapes *shape, shapes *other_shapes)
+{
+    shapes *temp = other_shapes;
+    while (temp != NULL)
+    {
+        if (shapes_equal(shape, temp))
+        {
+            return true;
+        }
+
+        temp = temp->next;
+    }
+
+    return false;
+}
+
+bool rotate_last_90_degrees(shapes *shape)
+{
+    shapes *current = shape;
+    while (current->next != NULL)
+    {
+        current = current->next;
+    }
+
+    // Declare new shape
+    shapes *new_shape = (shapes *)malloc(sizeof(shapes));
+
+    new_shape->width = current->height;
+    new_shape->height = current->width;
+
+    new_shape->next = NULL;
+
+    uint8_t *mask = (uint8_t *)malloc(sizeof(uint8_t) * new_shape->height);
+
+    uint8_t *current_line;
+
+    // Loop over shape and rotate it 90deg by swapping x and y when getting from original shape
+    for (int i = 0; i < new_shape->height; i++)
+    {
+        current_line = mask + i;
+        *current_line = 0;
+        for (int j = 0; j < new_shape->width; j++)
+        {
+            if (*(current->mask + current->height - 1 - j) & (1ULL << i))
+            {
+                *(mask + i) |= (1ULL << j);
+            }
+        }
+    }
+
+    // Add mask to shape
+    new_shape->mask = mask;
+
+    // Check if shape already in shapes array
+    if (shape_equal_in_list(new_shape, shape))
+    {
+        free_shapes(new_shape);
+        return true;
+    }
+
+    shapes *temp = shape;
+
+    while (temp->next != NULL)
+    {
+        temp = temp->next;
+    }
+
+    temp->next = new_shape;
+
+    return false;
+}
+
+bool mirror_shape(shapes *shape)
+{
+    shapes *current = shape;
+
+    // Declare new shape
+    shapes *new_shape = (shapes *)malloc(sizeof(shapes));
+
+    new_shape->width = current->width;
+    new_shape->height = current->height;
+    new_shape->next = NULL;
+
+    uint8_t *mask = (uint8_t *)malloc(sizeof(uint8_t) * new_shape->height);
+
+    uint8_t *current_line;
+
+    // Loop over shape and mirror it by swapping x and y when getting from original shape
+    for (int i = 0; i < new_shape->height; i++)
+    {
+        current_line = mask + i;
+        *current_line = 0;
+        for (int j = 0; j < new_shape->width; j++)
+        {
+            if (*(current->mask + i) & (1ULL << (new_shape->width - 1 - j)))
+            {
+                *(mask + i) |= (1ULL << j);
+            }
+        }
+    }
+
+    // Add mask to shape
+    new_shape->mask = mask;
+
+    // Check if shape already in shapes array
+    if (shape_equal_in_list(new_shape, shape))
+    {
+        free_shapes(new_shape);
+        return true;
+    }
+
+    shapes *temp = shape;
+
+    while (temp->next != NULL)
+    {
+        temp = temp->next;
+    }
+
+    temp->next = new_shape;
+
+    return false;
+}
+
+void add_shapes(shapes *new_shape, shapes_list *all_shapes, const bool mirror)
+{
+    // For each rotation create a shape and make it from the previous shape,
+    // then check it isn't equal to other shapes in list
+
+    bool isdone = rotate_last_90_degrees(new_shape); // 90deg rotations
+    if (!isdone)
+        isdone = rotate_last_90_degrees(new_shape); // 180deg rotations
+    if (!isdone)
+        isdone = rotate_last_90_degrees(new_shape); // 270deg rotations
+
+    if (mirror)
+    {
+        isdone = mirror_shape(new_shape); // Flip
+
+        if (!isdone)
+            isdone = rotate_last_90_degrees(new_shape); // 90deg rotations of flip
+        if (!isdone)
+            isdone = rotate_last_90_degrees(new_shape); // 180deg rotations of flip
+        if (!isdone)
+            isdone = rotate_last_90_degrees(new_shape); // 270deg rotations of flip
+    }
+
+    if ((all_shapes)->shapes == NULL)
+    {
+        (all_shapes)->shapes = new_shape;
+        all_shapes->next = NULL;
+        return;
+    }
+
+    shapes_list *new_list = (shapes_list *)malloc(sizeof(shapes_list));
+
+    new_list->next = NULL;
+    new_list->shapes = new_shape;
+
+    shapes_list *current = all_shapes;
+    while (current->next != NULL)
+    {
+        current = current->next;
+    }
+
+    current->next = new_list;
+}
@@ -0,0 +1,35 @@
+#ifndef PUZZLE_H
+#define PUZZLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct shapes
+{
+    int height, width;
+    struct shapes *next;
+    uint8_t *mask;
+} shapes;
+
+typedef struct shapes_list
+{
+    struct shapes *shapes;
+    struct shapes_list *next;
+} shapes_list;
+
+// Checking the board and shapes
+int count_full_spots(const shapes *shape);
+
+// Memory freeing
+void free_shapes(shapes *shape);
+void free_all_shapes(shapes *shape);
+void free_list(shapes_list *list);
+
+// Shape generation
+bool shapes_equal(const shapes *shape_1, const shapes *shape_2);
+bool shape_equal_in_list(const shapes *shape, shapes *other_shapes);
+bool rotate_last_90_degrees(shapes *shape);
+bool mirror_shape(shapes *shape);
+void add_shapes(shapes *new_shape, shapes_list *shapes_list, const bool mirror);
+
+#endif
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "runs.h"
+
+bool run_init(solution_run *run, const int key_size, const int data_size)
+{
+    memset(run, 0, sizeof(solution_run));
+    run->key_size = key_size;
+    run->data_size = data_size;
+    run->records = (uint16_t *)malloc(sizeof(uint16_t) * (key_size + data_size) * RUN_RECORDS);
+    if (run->records == NULL)
+    {
+        fprintf(stderr, "Error : cannot allocate the solution runs\n");
+        run->failed = true;
+        return false;
+    }
+    return true;
+}
+
+void run_free(solution_run *run)
+{
+    free(run->records);
+    run->records = NULL;
+    if (run->spill != NULL)
+        fclose(run->spill);
+    run->spill = NULL;
+}
+
+void run_append(solution_run *run, const uint16_t *key, const uint16_t *data)
+{
+    size_t size = run->key_size + run->data_size;
+    if (run->count == RUN_RECORDS && !run->failed)
+    {
+        if (run->spill == NULL)
+            run->spill = tmpfile();
+        if (run->spill == NULL || fwrite(run->records, sizeof(uint16_t) * size, run->count, run->spill) != run->count)
+        {
+            fprintf(stderr, "Error : cannot spill the solutions to a temporary file\n");
+            run->failed = true;
+        }
+        run->spilled += run->count;
+        run->count = 0;
+    }
+    if (run->failed)
+        return;
+
+    uint16_t *record = run->records + size * run->count++;
+    memcpy(record, key, sizeof(uint16_t) * run->key_size);
+    memcpy(record + run->key_size, data, sizeof(uint16_t) * run->data_size);
+}
+
+//-------------------------Merge-------------------------
+
+// Where the merge is in a run : its spilled records are read back a block at a time, then its
+// records in memory are taken in place
+typedef struct run_reader
+{
+    solution_run *run;
+    uint16_t *block;
+    uint64_t spilled_left;
+    const uint16_t *current, *end;
+} run_reader;
+
+static bool reader_next(run_reader *reader, bool *failed)
+{
+    size_t size = reader->run->key_size + reader->run->data_size;
+    if (reader->current != NULL)
+        reader->current += size;
+    if (reader->current != NULL && reader->current < reader->end)
+        return true;
+
+    if (reader->spilled_left > 0)
+    {
+        size_t records = reader->spilled_left < RUN_READ_RECORDS ? reader->spilled_left : RUN_READ_RECORDS;
+        if (fread(reader->block, sizeof(uint16_t) * size, records, reader->run->spill) != records)
+        {
+            fprintf(stderr, "Error : cannot read the spilled solutions back\n");
+            *failed = true;
+            return false;
+        }
+        reader->spilled_left -= records;
+        reader->current = reader->block;
+        reader->end = reader->block + size * records;
+        return true;
+    }
+
+    // Then the records still in memory, once
+    if (reader->end != reader->run->records + size * reader->run->count && reader->run->count > 0)
+    {
+        reader->current = reader->run->records;
+        reader->end = reader->run->records + size * reader->run->count;
+        return true;
+    }
+    return false;
+}
+
+static int compare_readers(const run_reader *a, const run_reader *b)
+{
+    for (int i = 0; i < a->run->key_size; i++)
+        if (a->current[i] != b->current[i])
+            return a->current[i] < b->current[i] ? -1 : 1;
+    return 0;
+}
+
+static void sift_down(run_reader **heap, const int size, int i)
+{
+    while (true)
+    {
+        int least = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < size && compare_readers(heap[left], heap[least]) < 0)
+            least = left;
+        if (right < size && compare_readers(heap[right], heap[least]) < 0)
+            least = right;
+        if (least == i)
+            return;
+        run_reader *swap = heap[i];
+        heap[i] = heap[least];
+        heap[least] = swap;
+        i = least;
+    }
+}
+
+int64_t runs_merge(solution_run *runs, const int count, run_callback callback, void *context)
+{
+    run_reader *readers = (run_reader *)calloc(count, sizeof(run_reader));
+    run_reader **heap = (run_reader **)calloc(count, sizeof(run_reader *));
+    bool failed = readers == NULL || heap == NULL;
+    int size = 0;
+    int64_t merged = 0;
+
+    // A heap of the runs by their next record
+    for (int r = 0; r < count && !failed; r++)
+    {
+        failed = runs[r].failed;
+        readers[r].run = runs + r;
+        readers[r].spilled_left = runs[r].spilled;
+        if (runs[r].spilled > 0)
+        {
+            rewind(runs[r].spill);
+            readers[r].block = (uint16_t *)malloc(sizeof(uint16_t) * (runs[r].key_size + runs[r].data_size) * RUN_READ_RECORDS);
+            failed |= readers[r].block == NULL;
+        }
+        if (!failed && reader_next(readers + r, &failed))
+            heap[size++] = readers + r;
+    }
+    for (int i = size / 2 - 1; i >= 0; i--)
+        sift_down(heap, size, i);
+
+    while (size > 0 && !failed)
+    {
+        run_reader *least = heap[0];
+        merged++;
+        if (!callback(least->current + least->run->key_size, context))
+            break;
+        if (!reader_next(least, &failed))
+            heap[0] = heap[--size];
+        sift_down(heap, size, 0);
+    }
+
+    for (int r = 0; r < count; r++)
+    {
+        if (readers != NULL)
+            free(readers[r].block);
+        runs[r].count = 0;
+        runs[r].spilled = 0;
+        if (runs[r].spill != NULL)
+            fclose(runs[r].spill);
+        runs[r].spill = NULL;
+    }
+    free(readers);
+    free(heap);
+    return failed ? -1 : merged;
+}
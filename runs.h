@@ -0,0 +1,39 @@
+#ifndef RUNS_H
+#define RUNS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Records kept in memory by a run before they are spilled, and read back at once by the merge
+#define RUN_RECORDS 65536
+#define RUN_READ_RECORDS 4096
+
+// Records of one worker in increasing key order, a record being a key of key_size uint16 compared
+// in lexicographic order, then data_size uint16 of data. Past RUN_RECORDS records the buffer is
+// appended to a temporary file, so a run takes a bounded memory whatever its length.
+typedef struct solution_run
+{
+    int key_size, data_size;
+    uint16_t *records;
+    uint32_t count;
+    FILE *spill;
+    uint64_t spilled;
+    bool failed;
+} solution_run;
+
+// Called with the data of every record in key order, returning false stops the merge
+typedef bool (*run_callback)(const uint16_t *data, void *context);
+
+// A run which can't be allocated drops its records and fails the merge
+bool run_init(solution_run *run, const int key_size, const int data_size);
+void run_free(solution_run *run);
+
+// The key must not be lower than the previous one's
+void run_append(solution_run *run, const uint16_t *key, const uint16_t *data);
+
+// Merges the runs by key and returns the number of records passed to callback, or -1 if a run
+// couldn't be written or read back. The runs are emptied.
+int64_t runs_merge(solution_run *runs, const int count, run_callback callback, void *context);
+
+#endif
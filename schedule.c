@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "schedule.h"
+
+#define LINE_LENGTH 256
+
+//-------------------------Timings-------------------------
+
+int schedule_date_index(const puzzle_tables *tables, const int *date)
+{
+    return (date[0] * tables_date_range(tables, 1) + date[1]) * tables_date_range(tables, 2) + date[2];
+}
+
+double *schedule_read_timings(const puzzle_tables *tables, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error : cannot open %s\n", path);
+        return NULL;
+    }
+
+    int total = tables_date_range(tables, 0) * tables_date_range(tables, 1) * tables_date_range(tables, 2);
+    double *timings = (double *)malloc(sizeof(double) * (total + 1));
+    for (int i = 0; i < total; i++)
+        timings[i] = -1;
+
+    char line[LINE_LENGTH];
+    int date[3];
+    unsigned long long solutions;
+    double seconds;
+    uint64_t board;
+    while (fgets(line, LINE_LENGTH, fp) != NULL)
+        if (sscanf(line, "%d;%d;%d;%llu;%lf", date, date + 1, date + 2, &solutions, &seconds) == 5 && tables_date_board(tables, date, &board))
+            timings[schedule_date_index(tables, date)] = seconds;
+
+    fclose(fp);
+    return timings;
+}
+
+//-------------------------Jobs-------------------------
+
+static int compare_jobs(const void *a, const void *b)
+{
+    double x = ((const schedule_job *)a)->cost, y = ((const schedule_job *)b)->cost;
+    return (x < y) - (x > y);
+}
+
+int schedule_dates(const puzzle_tables *tables, const int (*dates)[3], const int count, const double *timings, const int workers, schedule_job **jobs)
+{
+    double *estimates = (double *)malloc(sizeof(double) * (count + 1));
+    double *costs = (double *)malloc(sizeof(double) * (count + 1));
+    uint64_t *boards = (uint64_t *)malloc(sizeof(uint64_t) * (count + 1));
+
+    // Estimated nodes turn into seconds at the rate of the dates which were timed before
+    double timed_seconds = 0, timed_nodes = 0;
+    for (int i = 0; i < count; i++)
+    {
+        tables_date_board(tables, dates[i], boards + i);
+        uint64_t seed = (boards[i] ^ 0x9E3779B97F4A7C15ULL) | 1;
+        estimates[i] = engine_estimate(tables, boards[i], 0, SCHEDULE_SAMPLES, &seed);
+
+        double seconds = timings != NULL ? timings[schedule_date_index(tables, dates[i])] : -1;
+        if (seconds >= 0)
+        {
+            timed_seconds += seconds;
+            timed_nodes += estimates[i];
+        }
+    }
+
+    double scale = timed_nodes > 0 && timed_seconds > 0 ? timed_seconds / timed_nodes : 1;
+    double total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        double seconds = timings != NULL ? timings[schedule_date_index(tables, dates[i])] : -1;
+        costs[i] = seconds >= 0 ? seconds : estimates[i] * scale;
+        total += costs[i];
+    }
+
+    // Outliers are split, the rest of the dates are single jobs
+    double threshold = workers > 1 ? total / ((double)workers * SCHEDULE_SHARE) : INFINITY;
+    int capacity = count + 1, n = 0;
+    schedule_job *list = (schedule_job *)calloc(capacity, sizeof(schedule_job));
+    for (int i = 0; i < count; i++)
+    {
+        search_unit *units = NULL;
+        int parts = 0;
+        if (costs[i] > threshold)
+        {
+            int wanted = (int)fmin(ceil(costs[i] / threshold) * 2, SCHEDULE_MAX_UNITS);
+            parts = engine_split(tables, boards[i], wanted, SCHEDULE_SAMPLES / 4, &units);
+        }
+
+        if (n + parts + 1 > capacity)
+        {
+            capacity = (n + parts + 1) * 2;
+            list = (schedule_job *)realloc(list, sizeof(schedule_job) * capacity);
+        }
+
+        if (parts <= 1)
+        {
+            memset(list + n, 0, sizeof(schedule_job));
+            list[n].date_index = i;
+            list[n].cost = costs[i];
+            n++;
+        }
+        else
+        {
+            // The date's cost is shared between its units in proportion to their estimates
+            double sum = 0;
+            for (int u = 0; u < parts; u++)
+                sum += units[u].estimate;
+            for (int u = 0; u < parts; u++, n++)
+            {
+                memset(list + n, 0, sizeof(schedule_job));
+                list[n].date_index = i;
+                list[n].depth = units[u].depth;
+                memcpy(list[n].prefix, units[u].prefix, sizeof(uint16_t) * units[u].depth);
+                list[n].cost = sum > 0 ? costs[i] * units[u].estimate / sum : costs[i] / parts;
+            }
+        }
+        free(units);
+    }
+
+    // Longest first
+    qsort(list, n, sizeof(schedule_job), compare_jobs);
+
+    free(estimates);
+    free(costs);
+    free(boards);
+    *jobs = list;
+    return n;
+}
@@ -0,0 +1,36 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdint.h>
+
+#include "tables.h"
+#include "engine.h"
+
+// Random descents of each date's estimate
+#define SCHEDULE_SAMPLES 256
+// A date costing more than this share of a worker's part of the sweep is split into units
+#define SCHEDULE_SHARE 8
+#define SCHEDULE_MAX_UNITS 1024
+
+typedef struct schedule_job
+{
+    int date_index; // Index into the dates given to schedule_dates
+    int depth;
+    uint16_t prefix[MAX_PIECES];
+    double cost; // Predicted seconds, or estimated nodes when no timing is known
+} schedule_job;
+
+// Index of a date in year order, as ./days prints them
+int schedule_date_index(const puzzle_tables *tables, const int *date);
+
+// Seconds per date index read from the "month;day;week_day;solutions;seconds" lines of a previous
+// ./days run, -1 for the dates it doesn't have. NULL if the file can't be read.
+double *schedule_read_timings(const puzzle_tables *tables, const char *path);
+
+// Jobs for solving the dates, most expensive first. Costs are the previous timings when known and
+// tree size estimates otherwise, scaled to seconds by the dates having both. Dates costing more
+// than 1 / (workers * SCHEDULE_SHARE) of the total are split into prefix units, so that the
+// sweep's makespan gets close to the total divided by the workers. Returns the number of jobs.
+int schedule_dates(const puzzle_tables *tables, const int (*dates)[3], const int count, const double *timings, const int workers, schedule_job **jobs);
+
+#endif
@@ -4,709 +4,763 @@
 #include <string.h>
 #include <time.h>
 #include <stdint.h>
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "tables.h"
+#include "engine.h"
+#include "cache.h"
+#include "profile.h"
+#include "batch.h"
+#include "mitm.h"
+#include "frontier.h"
+#include "output.h"
+
+typedef struct solution_list
+{
+    uint16_t *placements; // pieces placement indexes per solution
+    uint32_t count, capacity;
+    int pieces;
+} solution_list;
 
-#define BOARD_HEIGHT 8
-#define BOARD_WIDTH 7
-#define BOARD_SIZE (sizeof(uint8_t) * BOARD_HEIGHT)
+// Command line
+void usage();
+void on_interrupt(int signal);
+void start_budget(search_budget *budget, const double timeout);
+void print_partial(const search_result *result);
 
-typedef struct shapes
-{
-    int height, width;
-    struct shapes *next;
-    uint8_t *mask;
-} shapes;
+// Batch mode
+int solve_batch(const char *puzzle_path, const char *batch_path, const int jobs, const uint64_t limit);
 
-typedef struct shapes_list
-{
-    struct shapes *shapes;
-    struct shapes_list *next;
-} shapes_list;
+// Counting engines
+int count_solutions(const char *puzzle_path, const int *date, const char *engine, const size_t memory, const char *filter_list, const double timeout);
 
-typedef struct node
-{
-    shapes *shape;
-    int x, y;
-    struct node *parent;
-} node;
+// Estimates
+#define ESTIMATE_SAMPLES 4096
+#define ESTIMATE_BATCHES 16
+int estimate_date(const char *puzzle_path, const int *date, const search_order order);
+void print_progress(const search_progress *progress, void *data);
+
+// Work units
+int export_units(const char *puzzle_path, const int *date, const int count);
+int solve_units(const char *puzzle_path, const char *units_path, const int jobs);
+
+// Output
+void write_solutions(const puzzle_tables *tables, const solution_list *solutions, const output_format format);
+
+// Cache
+void write_cached_solutions(const puzzle_tables *tables, const uint32_t count, const int pieces, const uint8_t *placements, const output_format format);
+void save_solutions(cache *cache, const puzzle_tables *tables, const solution_list *solutions, const int month, const int month_day, const int week_day);
 
-typedef struct node_list
+// Solutions generation
+bool store_solution(const puzzle_tables *tables, const uint16_t *placements, void *data);
+
+void usage()
 {
-    node *node;
-    struct node_list *next;
-} node_list;
+    fprintf(stderr, "Usage: ./solver [options] month day week_day\n"
+                    "  -p, --puzzle FILE  puzzle definition or compiled puzzle\n"
+                    "  -l, --limit K      stop after K solutions\n"
+                    "  -j, --jobs N       search with N threads\n"
+                    "  -o, --order NAME   fixed (default), piece (fewest legal placements first) or cell (fewest covering placements)\n"
+                    "  -E, --estimate     predict the nodes and the time of the search instead of solving\n"
+                    "      --progress S   report the progress and the time left on stderr every S seconds\n"
+                    "  -t, --timeout S    give up after S seconds and print what was found, as on Ctrl-C\n"
+                    "  -F, --fix LIST     pieces already on the board, as piece:variant:x:y separated by commas,\n"
+                    "                     only the other pieces are searched\n"
+                    "  -O, --format NAME  solutions as text (default), grid (the board labelled with piece ids), binary\n"
+                    "                     (uint16 placement indexes) or ndjson, the messages go to stderr but for text\n"
+                    "  -D, --ordered      with several jobs, the solutions in the order of a single job search\n"
+                    "  -b, --batch FILE   count the solutions of every \"month day week_day\" line of FILE (- for stdin),\n"
+                    "                     one JSON record per line\n"
+                    "  -s, --split N      print about N balanced work units of the date instead of solving it\n"
+                    "  -u, --units FILE   solve the work units of FILE (- for stdin) and print their counts\n"
+                    "  -e, --engine NAME  dfs (default, prints the solutions), or mitm (meet in the middle)\n"
+                    "                     and frontier (row-major dynamic programming) which only count\n"
+                    "  -m, --memory MB    memory for the mitm and frontier tables\n"
+                    "  -f, --filters LIST feasibility filters : parity, sizes, all (default) or none, checked at every node of\n"
+                    "                     the mitm and frontier engines and once on the date's board for dfs\n");
+    exit(1);
+}
+
+// Ctrl-C stops the running search, which prints its partial result
+search_token ginterrupt;
 
-typedef struct pointers
+// Messages of the solver, on stderr when stdout gets solutions in another format than text
+FILE *gmessages;
+
+void on_interrupt(int signal)
 {
-    node *pointer;
-    struct pointers *next;
-} pointers;
-
-int gcount = 0;
-node_list *terminal_nodes = NULL;
-
-// Checking the board and shapes
-int count_free_spots(const uint8_t *mask);
-int count_full_spots(const shapes *shape);
-
-// Debugging
-void print_shape(const shapes *shape);
-void print_all_shapes(shapes *shape);
-void print_shape_list(shapes_list *list);
-
-void print_solution(node *nodes);
-void print_all_solutions();
-
-// Memory freeing
-void free_shapes(shapes *shape);
-void free_all_shapes(shapes *shape);
-void free_list(shapes_list *list);
-
-bool in_pointers(pointers *pointer, node *node);
-void free_node_list(node_list *list);
-
-// Shape generation
-shapes *load_shape_from_file(const char *file_name);
-bool shapes_equal(const shapes *shape_1, const shapes *shape_2);
-bool shape_equal_in_list(const shapes *shape, shapes *other_shapes);
-bool rotate_last_90_degrees(shapes *shape);
-bool mirror_shape(shapes *shape);
-void add_shapes(shapes *new_shape, shapes_list *shapes_list, const bool mirror);
-
-// Board generation
-void print_board(const uint8_t *board);
-void mark_date(const int month, const int month_day, const int day, uint8_t *board);
-void generate_board(const int month, const int month_day, const int day, uint8_t *board);
+    (void)signal;
+    search_cancel(&ginterrupt);
+}
 
-// Solutions generation
-bool new_can_place(const shapes *shape, const int x, const int y, const uint8_t *board, uint8_t *new_board);
+void start_budget(search_budget *budget, const double timeout)
+{
+    search_token_init(&ginterrupt);
+    signal(SIGINT, on_interrupt);
+    budget->cancel = &ginterrupt;
+    budget->deadline = timeout > 0 ? engine_clock() + timeout : 0;
+}
 
-bool find_solutions(const shapes_list *shapes_list, const uint8_t *board, node *parent);
+void print_partial(const search_result *result)
+{
+    fprintf(gmessages, "Stopped before the end : %llu solutions found, %llu nodes, about %.1f%% of the search done.\n", (unsigned long long)result->solutions,
+           (unsigned long long)result->nodes, result->fraction * 100);
+}
 
 int main(int argc, char *argv[])
 {
+    const char *puzzle_path = NULL;
+    uint64_t limit = 0;
+    int jobs = 1;
+    const char *batch_path = NULL;
+    int split = 0;
+    const char *units_path = NULL;
+    const char *engine = "dfs";
+    size_t memory = MITM_DEFAULT_MEMORY;
+    const char *filter_list = "all";
+    search_order order = ORDER_FIXED;
+    bool estimate = false;
+    double progress_interval = 0;
+    double timeout = 0;
+    const char *fix_list = NULL;
+    output_format format = OUTPUT_TEXT;
+    bool ordered = false;
+
+    static const struct option long_options[] = {
+        {"puzzle", required_argument, NULL, 'p'},
+        {"limit", required_argument, NULL, 'l'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"order", required_argument, NULL, 'o'},
+        {"estimate", no_argument, NULL, 'E'},
+        {"progress", required_argument, NULL, 'P'},
+        {"timeout", required_argument, NULL, 't'},
+        {"fix", required_argument, NULL, 'F'},
+        {"format", required_argument, NULL, 'O'},
+        {"ordered", no_argument, NULL, 'D'},
+        {"batch", required_argument, NULL, 'b'},
+        {"split", required_argument, NULL, 's'},
+        {"units", required_argument, NULL, 'u'},
+        {"engine", required_argument, NULL, 'e'},
+        {"memory", required_argument, NULL, 'm'},
+        {"filters", required_argument, NULL, 'f'},
+        {NULL, 0, NULL, 0}};
+
+    gmessages = stdout;
+    int option;
+    while ((option = getopt_long(argc, argv, "p:l:j:o:Et:F:O:Db:s:u:e:m:f:", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'p':
+            puzzle_path = optarg;
+            break;
+        case 'l':
+            limit = strtoull(optarg, NULL, 10);
+            break;
+        case 'j':
+            jobs = atoi(optarg);
+            break;
+        case 'o':
+            if (!engine_parse_order(optarg, &order))
+                usage();
+            break;
+        case 'E':
+            estimate = true;
+            break;
+        case 'P':
+            progress_interval = atof(optarg);
+            break;
+        case 't':
+            timeout = atof(optarg);
+            break;
+        case 'F':
+            fix_list = optarg;
+            break;
+        case 'O':
+            if (!output_parse_format(optarg, &format))
+                usage();
+            break;
+        case 'D':
+            ordered = true;
+            break;
+        case 'b':
+            batch_path = optarg;
+            break;
+        case 's':
+            split = atoi(optarg);
+            break;
+        case 'u':
+            units_path = optarg;
+            break;
+        case 'e':
+            engine = optarg;
+            break;
+        case 'm':
+            memory = (size_t)strtoull(optarg, NULL, 10) << 20;
+            break;
+        case 'f':
+            filter_list = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+
+    if (batch_path != NULL)
+        return solve_batch(puzzle_path, batch_path, jobs, limit);
+    if (units_path != NULL)
+        return solve_units(puzzle_path, units_path, jobs);
+
     // Get month, day and number from command line arguments
     int month;
     int month_day;
     int week_day;
-    if (argc > 3)
+    if (argc - optind > 2)
     {
-        month = atoi(argv[1]);
-        month_day = atoi(argv[2]);
-        week_day = atoi(argv[3]);
+        month = atoi(argv[optind]);
+        month_day = atoi(argv[optind + 1]);
+        week_day = atoi(argv[optind + 2]);
     }
     else
-    {
-        perror("Usage: ./solver month day week_day");
-        exit(1);
-    }
-
-    // Make shapes
-    shapes_list *slist = (shapes_list *)malloc(sizeof(shapes_list));
-    slist->next = NULL;
-    slist->shapes = NULL;
-
-    printf("\nLoading shapes\n");
+        usage();
 
-    char filename[20];
-    for (int i = 1; i <= 10; i++)
+    if (split > 0)
     {
-        sprintf(filename, "shapes/%d.txt", i);
-        shapes *shape = load_shape_from_file(filename);
-        add_shapes(shape, slist, false);
+        int date[3] = {month, month_day, week_day};
+        return export_units(puzzle_path, date, split);
     }
-
-    printf("Shapes have been loaded\n");
-
-    printf("\nLoading board\n");
-
-    uint8_t board[BOARD_HEIGHT] = {0};
-    generate_board(month, month_day, week_day, board);
-
-    printf("Board Loaded\n");
-
-    printf("\nChecking board\n");
-
-    int board_spaces = count_free_spots(board);
-    int shape_blocks = 0;
-    shapes_list *shape_list_hold = slist;
-    while (shape_list_hold != NULL)
+    if (estimate)
     {
-        shape_blocks += count_full_spots(shape_list_hold->shapes);
-        shape_list_hold = shape_list_hold->next;
+        int date[3] = {month, month_day, week_day};
+        return estimate_date(puzzle_path, date, order);
     }
-
-    if (shape_blocks != board_spaces)
+    if (strcmp(engine, "dfs") != 0 && fix_list != NULL)
     {
-        printf("The space which needs to be occupied on the board has %d spaces, the shapes however can fill %d spaces.\n", board_spaces, shape_blocks);
-        return 0;
+        fprintf(stderr, "Error : --fix needs the dfs engine\n");
+        exit(1);
     }
-
-    printf("Board Checked\n");
-
-    printf("\nStarting search\n");
-
-    clock_t start = clock();
-    find_solutions(slist, board, NULL);
-    clock_t end = clock();
-
-    double cpu_time_used = ((double)(end - start)) / CLOCKS_PER_SEC;
-
-    print_all_solutions();
-
-    printf("Found %d solutions in %f seconds.\n", gcount, cpu_time_used);
-
-    // Free list
-    free_list(slist);
-    free_node_list(terminal_nodes);
-}
-
-//--------------------Pre-checks--------------------
-
-int count_free_spots(const uint8_t *board)
-{
-    int v = 0;
-    for (int i = 0; i < BOARD_HEIGHT; i++)
+    if (strcmp(engine, "dfs") != 0)
     {
-        uint8_t line = *(board + i);
-        for (int j = 0; j < BOARD_WIDTH; j++)
-            if (!(line & (1ULL << j)))
-                v++;
+        int date[3] = {month, month_day, week_day};
+        return count_solutions(puzzle_path, date, engine, memory, filter_list, timeout);
     }
 
-    return v;
-}
+    if (format != OUTPUT_TEXT)
+        gmessages = stderr;
 
-int count_full_spots(const shapes *shape)
-{
-    int v = 0;
+    // Make shapes
+    fprintf(gmessages, "\nLoading shapes\n");
 
-    uint8_t *mask = shape->mask;
-    for (int i = 0; i < shape->height; i++)
-        for (int j = 0; j < shape->width; j++)
-            if (*(mask + i) & (1ULL << j))
-                v++;
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    tables = profile_apply(tables);
 
-    return v;
-}
+    fprintf(gmessages, "Shapes have been loaded\n");
 
-//-------------------------Debugging-------------------------
+    // Repeated queries are answered from the cache, its key changes with the puzzle definition
+    cache *results = cache_open(tables->header->hash);
 
-void print_shape(const shapes *shape)
-{
-    uint8_t *mask = shape->mask;
+    // Cached lists are in the order of a single job with the fixed piece order, other orders can't
+    // be replayed from them
+    bool canonical = order == ORDER_FIXED && (jobs <= 1 || ordered);
 
-    for (int i = 0; i < shape->height; i++)
+    uint32_t cached_count;
+    int cached_pieces;
+    const uint8_t *cached_placements;
+    if (fix_list == NULL && canonical && cache_get_solutions(results, month, month_day, week_day, &cached_count, &cached_pieces, &cached_placements))
     {
-        for (int j = 0; j < shape->width; j++)
+        // The list is in printing order, the first solutions found are its last records
+        if (limit && cached_count > limit)
         {
-            if (*(mask + i) & (1ULL << j))
-                printf("1 ");
-            else
-                printf(". ");
+            cached_placements += (size_t)(cached_count - limit) * cached_pieces * 3;
+            cached_count = limit;
         }
-        printf("\n");
-    }
-}
+        write_cached_solutions(tables, cached_count, cached_pieces, cached_placements, format);
+        fprintf(gmessages, "Found %u solutions in cache.\n", cached_count);
 
-void print_all_shapes(shapes *shape)
-{
-    shapes *shapes_temp = shape;
-    while (shapes_temp != NULL)
-    {
-        print_shape(shapes_temp);
-        puts(" ");
-        shapes_temp = shapes_temp->next;
-    }
-}
-
-void print_shape_list(shapes_list *list)
-{
-    shapes_list *shapes_list_temp = list;
-    while (shapes_list_temp != NULL)
-    {
-        print_all_shapes(shapes_list_temp->shapes);
-        shapes_list_temp = shapes_list_temp->next;
+        cache_close(results);
+        tables_free(tables);
+        return 0;
     }
-}
 
-void print_solution(node *nodes)
-{
-    node *node_element = nodes;
-    while (node_element != NULL)
-    {
-        printf("\nPosition : (%d, %d)\n", node_element->x, node_element->y);
-        print_shape(node_element->shape);
-        node_element = node_element->parent;
-    }
-    printf("\n");
-}
+    fprintf(gmessages, "\nLoading board\n");
 
-void print_all_solutions()
-{
-    int c = 1;
-    node_list *list_element = terminal_nodes;
-    while (list_element != NULL)
+    int targets[3] = {month, month_day, week_day};
+    uint64_t board;
+    if (!tables_date_board(tables, targets, &board))
     {
-        printf("---------Solution %d---------\n", c);
-        print_solution(list_element->node);
-        list_element = list_element->next;
-        c++;
+        fprintf(stderr, "Error : %d %d %d isn't a date of this puzzle\n", month, month_day, week_day);
+        exit(1);
     }
-}
 
-//-------------------------Memory freeing-------------------------
+    fprintf(gmessages, "Board Loaded\n");
 
-void free_shapes(shapes *shape)
-{
-    free(shape->mask);
-    free(shape);
-}
+    fprintf(gmessages, "\nChecking board\n");
 
-void free_all_shapes(shapes *shape)
-{
-    shapes *temp;
-    while (shape != NULL)
-    {
-        temp = shape;
-        shape = shape->next;
-        free_shapes(temp);
-    }
-}
+    int board_spaces = tables_free_cells(tables, board);
+    int shape_blocks = tables_pieces_area(tables);
 
-void free_list(shapes_list *list)
-{
-    shapes_list *temp;
-    while (list != NULL)
+    if (shape_blocks != board_spaces)
     {
-        temp = list;
-        list = list->next;
-        free_all_shapes(temp->shapes);
-        free(temp);
+        fprintf(gmessages, "The space which needs to be occupied on the board has %d spaces, the shapes however can fill %d spaces.\n", board_spaces, shape_blocks);
+        cache_close(results);
+        tables_free(tables);
+        return 0;
     }
-}
 
-bool in_pointers(pointers *pointer, node *node)
-{
-    while (pointer != NULL)
-    {
-        if (pointer->pointer == node)
-            return true;
-        pointer = pointer->next;
+    // Pieces already on the board are checked, then pre-masked
+    uint16_t fixed[MAX_PIECES];
+    int fixed_count = 0;
+    uint64_t fixed_board = board;
+    uint32_t fixed_pieces = 0;
+    search_options options;
+    search_options_init(&options);
+    options.fixed = fixed;
+    if (fix_list != NULL)
+    {
+        if (!tables_parse_placements(tables, fix_list, fixed, &fixed_count))
+            exit(1);
+        options.fixed_count = fixed_count;
+        if (!engine_check_fixed(tables, board, &options, 0))
+            exit(1);
+        for (int i = 0; i < fixed_count; i++)
+        {
+            fixed_board |= tables->placements[fixed[i]].mask;
+            fixed_pieces |= 1u << tables->placements[fixed[i]].piece;
+        }
     }
-    return false;
-}
 
-void free_node_list(node_list *list)
-{
-    pointers *pointer = NULL;
-
-    node_list *temp_list;
-    while (list != NULL)
+    // Regions which no set of pieces can fill, or a colour imbalance the pieces can't match
+    bool parity, sizes;
+    filter_set filters;
+    if (filters_parse(filter_list, &parity, &sizes) && (parity || sizes) && filters_init(&filters, tables, parity, sizes))
     {
-        node *nodes = temp_list->node;
-        node *temp;
-        while (nodes != NULL)
+        bool feasible = filters_pass(&filters, fixed_board, fixed_pieces);
+        filters_free(&filters);
+        if (!feasible)
         {
-            if (!in_pointers(pointer, nodes))
-            {
-                pointers *new_pointer;
-                new_pointer->pointer = nodes;
-                new_pointer->next = pointer;
-                pointer = new_pointer;
-
-                temp = nodes;
-                nodes = nodes->parent;
-                free(temp);
-            }
-            else
-                nodes = NULL;
+            fprintf(gmessages, "The board can't be covered, its %s.\n", filters.size_hits ? "free regions don't match the sizes of the shapes" : "colours don't match the shapes");
+            cache_close(results);
+            tables_free(tables);
+            return 0;
         }
-        temp_list = list;
-        list = list->next;
-        free(temp_list);
     }
-}
-//-------------------------Shape Generation-------------------------
 
-shapes *load_shape_from_file(const char *file_name)
-{
-    shapes *shape = (shapes *)malloc(sizeof(shapes));
+    fprintf(gmessages, "Board Checked\n");
 
-    FILE *fp;
+    fprintf(gmessages, "\nStarting search\n");
 
-    fp = fopen(file_name, "r");
-    if (fp == NULL)
-    {
-        fprintf(stderr, "Erreur : Impossible d'ouvrir le fichier %s\n", file_name);
-        exit(1);
-    }
-    shape->next = NULL;
-    shape->height = 0;
-    shape->width = 0;
-    fscanf(fp, "%d", &shape->height);
-    fscanf(fp, "%d", &shape->width);
-
-    uint8_t *mask = (uint8_t *)malloc(sizeof(uint8_t) * shape->height);
-    if (mask == NULL)
-    {
-        fprintf(stderr, "Erreur : Impossible d'allouer de la mémoire\n");
-        exit(1);
-    }
+    solution_list solutions = {NULL, 0, 0, tables->header->pieces};
 
-    int data;
-    uint8_t *current_line;
-    for (int i = 0; i < shape->height; i++)
+    options.on_solution = store_solution;
+    options.data = &solutions;
+    options.limit = limit;
+    options.jobs = jobs;
+    options.order = order;
+    options.ordered = ordered;
+    if (progress_interval > 0)
     {
-        current_line = mask + i;
-        *current_line = 0;
-        for (int j = 0; j < shape->width; j++)
-        {
-            fscanf(fp, "%d", &data);
-            if (data != 0)
-                *(mask + i) |= 1ULL << j;
-        }
+        options.on_progress = print_progress;
+        options.progress_interval = progress_interval;
     }
+    start_budget(&options.budget, timeout);
 
-    shape->mask = mask;
+    clock_t start = clock();
+    search_result result = engine_search(tables, board, &options);
+    clock_t end = clock();
 
-    fclose(fp);
+    double cpu_time_used = ((double)(end - start)) / CLOCKS_PER_SEC;
 
-    return shape;
+    write_solutions(tables, &solutions, format);
+
+    fprintf(gmessages, "Found %llu solutions in %f seconds%s.\n", (unsigned long long)result.solutions, cpu_time_used,
+           result.expired ? " (interrupted)" : result.stopped ? " (limit reached)" : "");
+    if (result.expired)
+        print_partial(&result);
+    if (order != ORDER_FIXED)
+        fprintf(gmessages, "%llu nodes\n", (unsigned long long)result.nodes);
+
+    // A stopped search only tells that the date can be solved, if it found a solution. Solutions
+    // around fixed pieces aren't all the date's ones, but they do solve it. Only the count of a
+    // search in another order is kept.
+    if (!result.stopped && fix_list == NULL && canonical)
+        save_solutions(results, tables, &solutions, month, month_day, week_day);
+    else if (!result.stopped && fix_list == NULL)
+        cache_put_count(results, month, month_day, week_day, result.solutions);
+    else if (result.solutions > 0)
+        cache_put_exists(results, month, month_day, week_day, true);
+    cache_close(results);
+
+    free(solutions.placements);
+    tables_free(tables);
 }
 
-bool shapes_equal(const shapes *shape_1, const shapes *shape_2)
-{
-    // Start by comparing the sizes
-    if ((shape_1->width != shape_2->width) || (shape_1->height != shape_2->height))
-        return false;
+//-------------------------Batch mode-------------------------
 
-    uint8_t *mask_1 = shape_1->mask;
-    uint8_t *mask_2 = shape_2->mask;
-
-    // Then compare the contents
-    for (int i = 0; i < shape_1->height; i++)
+int solve_batch(const char *puzzle_path, const char *batch_path, const int jobs, const uint64_t limit)
+{
+    FILE *in = strcmp(batch_path, "-") == 0 ? stdin : fopen(batch_path, "r");
+    if (in == NULL)
     {
-        if (*(mask_1 + i) != *(mask_2 + i))
-            return false;
+        fprintf(stderr, "Error : cannot open %s\n", batch_path);
+        exit(1);
     }
 
-    return true;
-}
-
-bool shape_equal_in_list(const shapes *shape, shapes *other_shapes)
-{
-    shapes *temp = other_shapes;
-    while (temp != NULL)
-    {
-        if (shapes_equal(shape, temp))
-        {
-            return true;
-        }
+    // One table build and one cache for the whole batch
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    tables = profile_apply(tables);
+    if (!tables_check_dates(tables))
+        exit(1);
 
-        temp = temp->next;
-    }
+    cache *results = cache_open(tables->header->hash);
+    int status = run_batch(tables, results, in, stdout, jobs, limit);
 
-    return false;
+    cache_close(results);
+    tables_free(tables);
+    if (in != stdin)
+        fclose(in);
+    return status;
 }
 
-bool rotate_last_90_degrees(shapes *shape)
+//-------------------------Counting engines-------------------------
+
+int count_solutions(const char *puzzle_path, const int *date, const char *engine, const size_t memory, const char *filter_list, const double timeout)
 {
-    shapes *current = shape;
-    while (current->next != NULL)
+    if (strcmp(engine, "mitm") != 0 && strcmp(engine, "frontier") != 0)
     {
-        current = current->next;
+        fprintf(stderr, "Error : unknown engine %s\n", engine);
+        exit(1);
     }
 
-    // Declare new shape
-    shapes *new_shape = (shapes *)malloc(sizeof(shapes));
-
-    new_shape->width = current->height;
-    new_shape->height = current->width;
-
-    new_shape->next = NULL;
-
-    uint8_t *mask = (uint8_t *)malloc(sizeof(uint8_t) * new_shape->height);
+    bool parity, sizes;
+    if (!filters_parse(filter_list, &parity, &sizes))
+        exit(1);
 
-    uint8_t *current_line;
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    tables = profile_apply(tables);
 
-    // Loop over shape and rotate it 90deg by swapping x and y when getting from original shape
-    for (int i = 0; i < new_shape->height; i++)
+    uint64_t board;
+    if (!tables_date_board(tables, date, &board))
     {
-        current_line = mask + i;
-        *current_line = 0;
-        for (int j = 0; j < new_shape->width; j++)
-        {
-            if (*(current->mask + current->height - 1 - j) & (1ULL << i))
-            {
-                *(mask + i) |= (1ULL << j);
-            }
-        }
+        fprintf(stderr, "Error : %d %d %d isn't a date of this puzzle\n", date[0], date[1], date[2]);
+        exit(1);
     }
 
-    // Add mask to shape
-    new_shape->mask = mask;
-
-    // Check if shape already in shapes array
-    if (shape_equal_in_list(new_shape, shape))
+    cache *results = cache_open(tables->header->hash);
+    uint64_t count;
+    if (cache_get_count(results, date[0], date[1], date[2], &count))
+        printf("Found %llu solutions in cache.\n", (unsigned long long)count);
+    else
     {
-        free_shapes(new_shape);
-        return true;
-    }
+        clock_t start = clock();
+        filter_set filters;
+        if (!filters_init(&filters, tables, parity, sizes))
+            exit(1);
+        filter_set *active = parity || sizes ? &filters : NULL;
+
+        search_budget budget;
+        start_budget(&budget, timeout);
+        search_result result;
+        if (strcmp(engine, "mitm") == 0)
+            result = mitm_count(tables, board, mitm_split(tables, board, MITM_SAMPLES), memory, active, &budget);
+        else
+            result = frontier_count(tables, board, memory, active, &budget);
+        clock_t end = clock();
+
+        printf("Found %llu solutions in %f seconds%s.\n", (unsigned long long)result.solutions, ((double)(end - start)) / CLOCKS_PER_SEC, result.expired ? " (interrupted)" : "");
+        if (result.expired)
+            print_partial(&result);
+        printf("%llu nodes, %llu filter checks, %llu cut by parity, %llu cut by sizes\n", (unsigned long long)result.nodes, (unsigned long long)filters.checks,
+               (unsigned long long)filters.parity_hits, (unsigned long long)filters.size_hits);
+        filters_free(&filters);
+        if (!result.stopped)
+            cache_put_count(results, date[0], date[1], date[2], result.solutions);
+    }
+
+    cache_close(results);
+    tables_free(tables);
+    return 0;
+}
 
-    shapes *temp = shape;
+//-------------------------Estimates-------------------------
 
-    while (temp->next != NULL)
+int estimate_date(const char *puzzle_path, const int *date, const search_order order)
+{
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    tables = profile_apply(tables);
+
+    uint64_t board;
+    if (!tables_date_board(tables, date, &board))
     {
-        temp = temp->next;
+        fprintf(stderr, "Error : %d %d %d isn't a date of this puzzle\n", date[0], date[1], date[2]);
+        exit(1);
     }
+    if (order != ORDER_FIXED)
+        fprintf(stderr, "Warning : the estimate is the one of the fixed order search\n");
 
-    temp->next = new_shape;
-
-    return false;
+    // Knuth's estimator, the spread of the batches' means gives the standard error
+    uint64_t seed = (board ^ 0x9E3779B97F4A7C15ULL) | 1;
+    double means[ESTIMATE_BATCHES], mean = 0, variance = 0;
+    clock_t start = clock();
+    for (int i = 0; i < ESTIMATE_BATCHES; i++)
+    {
+        means[i] = engine_estimate(tables, board, 0, ESTIMATE_SAMPLES / ESTIMATE_BATCHES, &seed);
+        mean += means[i] / ESTIMATE_BATCHES;
+    }
+    for (int i = 0; i < ESTIMATE_BATCHES; i++)
+        variance += (means[i] - mean) * (means[i] - mean) / (ESTIMATE_BATCHES - 1);
+    double error = sqrt(variance / ESTIMATE_BATCHES);
+    double sampling = ((double)(clock() - start)) / CLOCKS_PER_SEC;
+
+    // The node rate comes from solving a unit of about a 64th of the tree
+    search_unit *units;
+    int n = engine_split(tables, board, 64, 64, &units);
+    int chosen = 0;
+    for (int i = 1; i < n; i++)
+        if (fabs(units[i].estimate - mean / 64) < fabs(units[chosen].estimate - mean / 64))
+            chosen = i;
+
+    search_options options;
+    search_options_init(&options);
+    start = clock();
+    search_result sample = engine_search_from(tables, board, units[chosen].prefix, units[chosen].depth, &options);
+    double seconds = ((double)(clock() - start)) / CLOCKS_PER_SEC;
+    double rate = sample.nodes > 0 && seconds > 0 ? sample.nodes / seconds : 0;
+    free(units);
+
+    printf("Estimated nodes : %.4g (standard error %.2g)\n", mean, error);
+    if (rate > 0)
+        printf("Estimated time : %.3g seconds at %.3g nodes per second\n", mean / rate, rate);
+    printf("Estimate made in %f seconds.\n", sampling + seconds);
+
+    tables_free(tables);
+    return 0;
 }
 
-bool mirror_shape(shapes *shape)
+void print_progress(const search_progress *progress, void *data)
 {
-    shapes *current = shape;
-
-    // Declare new shape
-    shapes *new_shape = (shapes *)malloc(sizeof(shapes));
-
-    new_shape->width = current->width;
-    new_shape->height = current->height;
-    new_shape->next = NULL;
+    (void)data;
+    if (progress->fraction < 0)
+        fprintf(stderr, "progress : %llu nodes, %llu solutions, %.1f s\n", (unsigned long long)progress->nodes, (unsigned long long)progress->solutions, progress->elapsed);
+    else
+        fprintf(stderr, "progress : %.1f%%, %llu nodes, %llu solutions, %.1f s, about %.1f s left\n", progress->fraction * 100, (unsigned long long)progress->nodes,
+                (unsigned long long)progress->solutions, progress->elapsed, progress->eta);
+}
 
-    uint8_t *mask = (uint8_t *)malloc(sizeof(uint8_t) * new_shape->height);
+//-------------------------Work units-------------------------
 
-    uint8_t *current_line;
+#define UNIT_SAMPLES 64
+#define UNIT_LINE_LENGTH 512
 
-    // Loop over shape and mirror it by swapping x and y when getting from original shape
-    for (int i = 0; i < new_shape->height; i++)
-    {
-        current_line = mask + i;
-        *current_line = 0;
-        for (int j = 0; j < new_shape->width; j++)
-        {
-            if (*(current->mask + i) & (1ULL << (new_shape->width - 1 - j)))
-            {
-                *(mask + i) |= (1ULL << j);
-            }
-        }
-    }
-
-    // Add mask to shape
-    new_shape->mask = mask;
+int export_units(const char *puzzle_path, const int *date, const int count)
+{
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    tables = profile_apply(tables);
 
-    // Check if shape already in shapes array
-    if (shape_equal_in_list(new_shape, shape))
+    uint64_t board;
+    if (!tables_date_board(tables, date, &board))
     {
-        free_shapes(new_shape);
-        return true;
+        fprintf(stderr, "Error : %d %d %d isn't a date of this puzzle\n", date[0], date[1], date[2]);
+        exit(1);
     }
 
-    shapes *temp = shape;
-
-    while (temp->next != NULL)
+    // One line per unit : unit month day week_day depth prefix... board estimate
+    search_unit *units;
+    int n = tables_free_cells(tables, board) == tables_pieces_area(tables) ? engine_split(tables, board, count, UNIT_SAMPLES, &units) : 0;
+    for (int i = 0; i < n; i++)
     {
-        temp = temp->next;
+        printf("unit %d %d %d %d", date[0], date[1], date[2], units[i].depth);
+        for (int d = 0; d < units[i].depth; d++)
+            printf(" %u", units[i].prefix[d]);
+        printf(" %016llx %.0f\n", (unsigned long long)units[i].board, units[i].estimate);
     }
+    if (n > 0)
+        free(units);
 
-    temp->next = new_shape;
-
-    return false;
+    tables_free(tables);
+    return 0;
 }
 
-void add_shapes(shapes *new_shape, shapes_list *all_shapes, const bool mirror)
+int solve_units(const char *puzzle_path, const char *units_path, const int jobs)
 {
-    // For each rotation create a shape and make it from the previous shape,
-    // then check it isn't equal to other shapes in list
-
-    bool isdone = rotate_last_90_degrees(new_shape); // 90deg rotations
-    if (!isdone)
-        isdone = rotate_last_90_degrees(new_shape); // 180deg rotations
-    if (!isdone)
-        isdone = rotate_last_90_degrees(new_shape); // 270deg rotations
-
-    if (mirror)
-    {
-        isdone = mirror_shape(new_shape); // Flip
-
-        if (!isdone)
-            isdone = rotate_last_90_degrees(new_shape); // 90deg rotations of flip
-        if (!isdone)
-            isdone = rotate_last_90_degrees(new_shape); // 180deg rotations of flip
-        if (!isdone)
-            isdone = rotate_last_90_degrees(new_shape); // 270deg rotations of flip
-    }
-
-    if ((all_shapes)->shapes == NULL)
+    FILE *in = strcmp(units_path, "-") == 0 ? stdin : fopen(units_path, "r");
+    if (in == NULL)
     {
-        (all_shapes)->shapes = new_shape;
-        all_shapes->next = NULL;
-        return;
+        fprintf(stderr, "Error : cannot open %s\n", units_path);
+        exit(1);
     }
 
-    shapes_list *new_list = (shapes_list *)malloc(sizeof(shapes_list));
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    tables = profile_apply(tables);
 
-    new_list->next = NULL;
-    new_list->shapes = new_shape;
+    search_options options;
+    search_options_init(&options);
+    options.jobs = jobs;
 
-    shapes_list *current = all_shapes;
-    while (current->next != NULL)
+    char line[UNIT_LINE_LENGTH];
+    int line_number = 0, status = 0;
+    uint64_t total = 0;
+    clock_t start = clock();
+    while (fgets(line, UNIT_LINE_LENGTH, in) != NULL)
     {
-        current = current->next;
-    }
+        line_number++;
+        if (line[strspn(line, " \t\r\n")] == '\0' || line[0] == '#')
+            continue;
 
-    current->next = new_list;
-}
-
-//-------------------------Board Generation-------------------------
+        int date[3], depth, offset;
+        if (sscanf(line, "unit %d %d %d %d%n", date, date + 1, date + 2, &depth, &offset) != 4 || depth < 0 || depth > (int)tables->header->pieces)
+        {
+            fprintf(stderr, "Error : line %d isn't a work unit\n", line_number);
+            status = 1;
+            continue;
+        }
 
-void print_board(const uint8_t *board)
-{
-    for (int i = 0; i < BOARD_HEIGHT; i++)
-    {
-        uint8_t line = *(board + i);
-        for (int j = 0; j < BOARD_WIDTH; j++)
+        search_unit unit;
+        unit.depth = depth;
+        const char *rest = line + offset;
+        bool valid = true;
+        for (int d = 0; d < depth && valid; d++)
         {
-            if (line & (1ULL << j))
-                printf("1 ");
-            else
-                printf(". ");
+            unsigned value;
+            int n = 0;
+            valid = sscanf(rest, "%u%n", &value, &n) == 1 && value < tables->header->placements;
+            unit.prefix[d] = value;
+            rest += n;
+        }
+        unsigned long long unit_board;
+        valid = valid && sscanf(rest, "%llx", &unit_board) == 1;
+
+        // The unit must describe a prefix of this puzzle's search for this date : the placement of
+        // depth d is one of piece d, the order of the split, and the placements don't overlap
+        uint64_t board;
+        valid = valid && tables_date_board(tables, date, &board);
+        for (int d = 0; d < depth && valid; d++)
+        {
+            const placement *chosen = tables->placements + unit.prefix[d];
+            valid = chosen->piece == d && (board & chosen->mask) == 0;
+            board |= chosen->mask;
+        }
+        if (!valid || board != unit_board)
+        {
+            fprintf(stderr, "Error : the work unit of line %d doesn't belong to this puzzle\n", line_number);
+            status = 1;
+            continue;
         }
-        printf("\n");
-    }
-}
 
-void mark_date(const int month, const int month_day, const int day, uint8_t *board)
-{
-    // 1 on the board corresponds to a block (not placeable slot)
-    if (month <= 5)
-        board[0] |= 1UL << month;
-    else
-        board[1] |= 1UL << month - 6;
+        tables_date_board(tables, date, &board);
+        search_result result = engine_search_from(tables, board, unit.prefix, depth, &options);
+        printf("%d;%d;%d;%d;%llu\n", date[0], date[1], date[2], line_number, (unsigned long long)result.solutions);
+        total += result.solutions;
+    }
+    clock_t end = clock();
 
-    // Defining the month-day position
-    board[(month_day / 7) + 2] |= 1UL << (month_day % 7);
+    printf("Found %llu solutions in %f seconds.\n", (unsigned long long)total, ((double)(end - start)) / CLOCKS_PER_SEC);
 
-    // Defining the day
-    if (day <= 3)
-        board[6] |= 1UL << (day + 3);
-    else
-        board[7] |= 1UL << day;
+    tables_free(tables);
+    if (in != stdin)
+        fclose(in);
+    return status;
 }
 
-void generate_board(const int month, const int month_day, const int day, uint8_t *board)
+//-------------------------Output-------------------------
+
+void write_solutions(const puzzle_tables *tables, const solution_list *solutions, const output_format format)
 {
-    // First blocks the date slots
-    mark_date(month, month_day, day, board);
+    // Messages written so far come first, the solutions bypass stdio
+    fflush(stdout);
 
-    // Blocks the border slots
-    board[0] |= 1UL << 6;
-    board[1] |= 1UL << 6;
-    board[7] |= 0x0F; // 0 0 0 0 1 1 1 1
+    // Latest solution first, as the original solver did
+    solution_writer writer;
+    if (!output_open(&writer, tables, format, STDOUT_FILENO))
+        return;
+    for (uint32_t c = 0; c < solutions->count; c++)
+        output_solution(&writer, solutions->placements + (size_t)(solutions->count - 1 - c) * solutions->pieces);
+    output_close(&writer);
 }
 
-//-----------------------------------FIND SOLUTIONS-----------------------------------
-bool can_place(const shapes *shape, const int x, const int y, const uint8_t *board)
+//-------------------------Cache-------------------------
+
+void write_cached_solutions(const puzzle_tables *tables, const uint32_t count, const int pieces, const uint8_t *placements, const output_format format)
 {
-    uint8_t *mask = shape->mask;
+    if (pieces != (int)tables->header->pieces)
+        return;
 
-    for (int i = 0; i < shape->height; i++)
+    // Cached as variant, x and y per piece in printing order, stored the other way round here
+    solution_list solutions = {(uint16_t *)malloc(sizeof(uint16_t) * ((size_t)count * pieces + 1)), 0, count, pieces};
+    for (uint32_t c = 0; c < count; c++)
     {
-        if (*(board + i + y) & (*(mask + i) << x))
-            return false;
+        const uint8_t *record = placements + (size_t)(count - 1 - c) * pieces * 3;
+        uint16_t *solution = solutions.placements + (size_t)solutions.count * pieces;
+        bool valid = true;
+        for (int i = 0; i < pieces && valid; i++)
+        {
+            int p = tables_find_placement(tables, i, record[i * 3], record[i * 3 + 1], record[i * 3 + 2]);
+            valid = p >= 0;
+            solution[i] = p;
+        }
+        solutions.count += valid;
     }
 
-    return true;
+    write_solutions(tables, &solutions, format);
+    free(solutions.placements);
 }
 
-void place(const shapes *shape, const int x, const int y, uint8_t *board)
+void save_solutions(cache *cache, const puzzle_tables *tables, const solution_list *solutions, const int month, const int month_day, const int week_day)
 {
-    uint8_t *mask = shape->mask;
+    if (cache == NULL)
+        return;
 
-    int i = shape->height;
+    const tables_header *header = tables->header;
+    int pieces = solutions->pieces;
+    uint8_t *placements = (uint8_t *)calloc((size_t)solutions->count * pieces * 3 + 1, 1);
 
-    while (i)
+    // Stored in printing order
+    for (uint32_t c = 0; c < solutions->count; c++)
     {
-        i--;
-        *(board + i + y) |= (*(mask + i) << x);
+        const uint16_t *solution = solutions->placements + (size_t)(solutions->count - 1 - c) * pieces;
+        uint8_t *record = placements + (size_t)c * pieces * 3;
+        for (int i = 0; i < pieces; i++)
+        {
+            const placement *chosen = tables->placements + solution[i];
+            record[i * 3] = (uint8_t)(chosen->variant - header->piece_variants[i]);
+            record[i * 3 + 1] = chosen->x;
+            record[i * 3 + 2] = chosen->y;
+        }
     }
+
+    cache_put_solutions(cache, month, month_day, week_day, solutions->count, pieces, placements);
+    free(placements);
 }
 
-bool new_can_place(const shapes *shape, const int x, const int y, const uint8_t *board, uint8_t *new_board)
-{
-    uint8_t *mask = shape->mask;
-    uint8_t *new_board_pointer = new_board + y;
+//-----------------------------------FIND SOLUTIONS-----------------------------------
 
-    int i = shape->height;
+bool store_solution(const puzzle_tables *tables, const uint16_t *placements, void *data)
+{
+    solution_list *solutions = (solution_list *)data;
+    uint32_t pieces = tables->header->pieces;
 
-    while (i)
+    if (solutions->count == solutions->capacity)
     {
-        i--;
-
-        uint8_t board_value = *(board + i + y);
-        uint8_t mask_value = *(mask + i) << x;
-
-        if (board_value & mask_value)
-            return false;
-
-        *(new_board_pointer + i) = board_value | mask_value;
+        solutions->capacity = solutions->capacity ? solutions->capacity * 2 : 64;
+        solutions->placements = (uint16_t *)realloc(solutions->placements, sizeof(uint16_t) * solutions->capacity * pieces);
     }
 
+    memcpy(solutions->placements + (size_t)solutions->count * pieces, placements, sizeof(uint16_t) * pieces);
+    solutions->count++;
+
     return true;
 }
-
-bool find_solutions(const shapes_list *shapes_list, const uint8_t *board, node *parent)
-{
-    if (shapes_list == NULL)
-    {
-        node_list *new_element = (node_list *)malloc(sizeof(node_list));
-        new_element->node = parent;
-        new_element->next = terminal_nodes;
-        terminal_nodes = new_element;
-
-        gcount++;
-        return true;
-    }
-
-    shapes *current_shape = shapes_list->shapes;
-
-    bool sol_in_tree = false;
-
-    // For each shape variant
-    while (current_shape != NULL)
-    {
-        int h = BOARD_HEIGHT - current_shape->height + 1;
-        int w = BOARD_WIDTH - current_shape->width + 1;
-
-        // For each slots
-        for (int y = 0; y < h; y++)
-        {
-            for (int x = 0; x < w; x++)
-            {
-                uint8_t new_board[BOARD_HEIGHT];
-                memcpy(new_board, board, BOARD_SIZE);
-
-                if (new_can_place(current_shape, x, y, board, new_board))
-                {
-                    node *new_node = (node *)malloc(sizeof(node));
-                    bool sol_in_branch = find_solutions(shapes_list->next, new_board, new_node);
-                    if (sol_in_branch)
-                    {
-                        new_node->x = x;
-                        new_node->y = y;
-                        new_node->shape = current_shape;
-                        new_node->parent = parent;
-                        sol_in_tree = true;
-                    }
-                    else
-                        free(new_node);
-                }
-            }
-        }
-
-        current_shape = current_shape->next;
-    }
-    return sol_in_tree;
-}
\ No newline at end of file
@@ -0,0 +1,880 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+#include <signal.h>
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "tables.h"
+#include "engine.h"
+#include "cache.h"
+#include "filters.h"
+#include "hint.h"
+
+#define LINE_LENGTH 256
+#define LATENCY_SAMPLES 65536
+
+typedef struct connection connection;
+
+typedef struct request
+{
+    char line[LINE_LENGTH];
+    char *reply;
+    bool done;
+    struct timespec received;
+    connection *connection;
+    struct request *next;       // Next request of the same connection, replies keep this order
+    struct request *next_queued; // Next request waiting for a worker
+} request;
+
+struct connection
+{
+    int fd; // Socket of the connection, -1 on stdin
+    FILE *in, *out;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    request *head, *tail;
+    bool closed;
+    connection *next_open; // Next connection still served on the socket
+};
+
+typedef struct reply_buffer
+{
+    char *data;
+    size_t length, capacity;
+} reply_buffer;
+
+typedef struct server
+{
+    puzzle_tables *tables;
+
+    cache *results;
+    pthread_mutex_t cache_lock;
+
+    pthread_mutex_t queue_lock;
+    pthread_cond_t queue_cond;
+    request *queue_head, *queue_tail;
+    bool stopping;
+
+    // Connections served on the socket, shut down and waited for before the pool stops
+    pthread_mutex_t connections_lock;
+    pthread_cond_t connections_cond;
+    connection *open_connections;
+    int open_count;
+
+    pthread_mutex_t stats_lock;
+    double *latencies; // Ring of the last LATENCY_SAMPLES latencies, in microseconds
+    uint64_t requests;
+
+    double timeout;      // Seconds a request may take from its arrival, 0 for no limit
+    search_token cancel; // Cancels the running searches on shutdown
+
+    // States counted by the moves requests, shared by every request and kept until shutdown
+    filter_set filters;
+    hint_table hints;
+    pthread_mutex_t hints_lock;
+} server;
+
+server gserver;
+volatile sig_atomic_t gstop = 0;
+
+// Command line
+void usage();
+void on_signal(int signal);
+
+// Replies
+void reply_append(reply_buffer *reply, const char *format, ...);
+bool date_board(const int *date, uint64_t *board);
+void reply_expired(reply_buffer *reply, const search_result *result);
+void reply_count(reply_buffer *reply, const int *date, const search_budget *budget);
+void reply_exists(reply_buffer *reply, const int *date, const search_budget *budget);
+void reply_solutions(reply_buffer *reply, const int *date, uint64_t limit, bool hint, const search_budget *budget);
+void reply_complete(reply_buffer *reply, const int *date, const char *list, const search_budget *budget);
+void reply_moves(reply_buffer *reply, const int *date, const char *list, bool count, const search_budget *budget);
+void reply_stats(reply_buffer *reply);
+char *handle_request(const char *line, const search_budget *budget);
+
+// Statistics
+void record_latency(const struct timespec *start);
+void latency_percentiles(double *p50, double *p99, uint64_t *requests);
+
+// Worker pool
+void submit(request *new_request);
+void *worker(void *data);
+
+// Connections
+void *connection_writer(void *data);
+void serve_connection(connection *client);
+void *connection_thread(void *data);
+void close_connections();
+int serve_socket(const char *path);
+
+void usage()
+{
+    fprintf(stderr, "Usage: ./solverd [options]\n"
+                    "  -p, --puzzle FILE  puzzle definition or compiled puzzle\n"
+                    "  -s, --socket PATH  listen on a Unix socket instead of stdin/stdout\n"
+                    "  -j, --jobs N       worker threads\n"
+                    "  -t, --timeout S    answer \"error timeout\" to the requests still searching S seconds after their arrival\n"
+                    "  -m, --memory MB    bound of the states table of the moves requests\n"
+                    "Requests, one per line: count|exists|hint M D W, first K M D W, complete M D W piece:variant:x:y,...,\n"
+                    "moves|counts M D W [piece:variant:x:y,...], stats, quit\n");
+    exit(1);
+}
+
+void on_signal(int signal)
+{
+    (void)signal;
+    gstop = 1;
+    search_cancel(&gserver.cancel);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *puzzle_path = NULL;
+    const char *socket_path = NULL;
+    int jobs = 4;
+    size_t memory = HINT_DEFAULT_MEMORY;
+
+    static const struct option long_options[] = {
+        {"puzzle", required_argument, NULL, 'p'},
+        {"socket", required_argument, NULL, 's'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"timeout", required_argument, NULL, 't'},
+        {"memory", required_argument, NULL, 'm'},
+        {NULL, 0, NULL, 0}};
+
+    search_token_init(&gserver.cancel);
+    int option;
+    while ((option = getopt_long(argc, argv, "p:s:j:t:m:", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'p':
+            puzzle_path = optarg;
+            break;
+        case 's':
+            socket_path = optarg;
+            break;
+        case 'j':
+            jobs = atoi(optarg);
+            break;
+        case 't':
+            gserver.timeout = atof(optarg);
+            break;
+        case 'm':
+            memory = (size_t)atol(optarg) << 20;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (jobs < 1)
+        jobs = 1;
+
+    // Everything is loaded once and stays warm for every request
+    gserver.tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (gserver.tables == NULL)
+        exit(1);
+    if (!tables_check_dates(gserver.tables))
+        exit(1);
+
+    gserver.results = cache_open(gserver.tables->header->hash);
+    if (!filters_init(&gserver.filters, gserver.tables, true, true) || !hint_init(&gserver.hints, gserver.tables, memory, &gserver.filters))
+        exit(1);
+    gserver.latencies = (double *)calloc(LATENCY_SAMPLES, sizeof(double));
+    pthread_mutex_init(&gserver.cache_lock, NULL);
+    pthread_mutex_init(&gserver.queue_lock, NULL);
+    pthread_cond_init(&gserver.queue_cond, NULL);
+    pthread_mutex_init(&gserver.stats_lock, NULL);
+    pthread_mutex_init(&gserver.hints_lock, NULL);
+    pthread_mutex_init(&gserver.connections_lock, NULL);
+    pthread_cond_init(&gserver.connections_cond, NULL);
+
+    // Without SA_RESTART, a signal also interrupts the read of the next request on stdin
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    pthread_t *workers = (pthread_t *)malloc(sizeof(pthread_t) * jobs);
+    for (int i = 0; i < jobs; i++)
+        pthread_create(workers + i, NULL, worker, NULL);
+
+    int status = 0;
+    if (socket_path != NULL)
+        status = serve_socket(socket_path);
+    else
+    {
+        connection client;
+        client.fd = -1;
+        client.in = stdin;
+        client.out = stdout;
+        serve_connection(&client);
+    }
+
+    // Stop the pool once every connection is closed and every queued request has been answered
+    pthread_mutex_lock(&gserver.queue_lock);
+    gserver.stopping = true;
+    pthread_cond_broadcast(&gserver.queue_cond);
+    pthread_mutex_unlock(&gserver.queue_lock);
+    for (int i = 0; i < jobs; i++)
+        pthread_join(workers[i], NULL);
+    free(workers);
+
+    double p50, p99;
+    uint64_t requests;
+    latency_percentiles(&p50, &p99, &requests);
+    fprintf(stderr, "Served %llu requests, latency p50 %.1f us, p99 %.1f us\n", (unsigned long long)requests, p50, p99);
+
+    cache_close(gserver.results);
+    hint_free(&gserver.hints);
+    filters_free(&gserver.filters);
+    tables_free(gserver.tables);
+    free(gserver.latencies);
+    return status;
+}
+
+//-------------------------Replies-------------------------
+
+void reply_append(reply_buffer *reply, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (reply->length + n + 1 > reply->capacity)
+    {
+        while (reply->length + n + 1 > reply->capacity)
+            reply->capacity = reply->capacity ? reply->capacity * 2 : 128;
+        reply->data = (char *)realloc(reply->data, reply->capacity);
+    }
+
+    va_start(args, format);
+    vsnprintf(reply->data + reply->length, n + 1, format, args);
+    va_end(args);
+    reply->length += n;
+}
+
+bool date_board(const int *date, uint64_t *board)
+{
+    if (!tables_date_board(gserver.tables, date, board))
+        return false;
+    return tables_free_cells(gserver.tables, *board) == tables_pieces_area(gserver.tables);
+}
+
+void reply_expired(reply_buffer *reply, const search_result *result)
+{
+    // Nothing is cached, the partial counts only tell how far the search went
+    reply_append(reply, "error %s after %llu solutions, %.1f%% searched", atomic_load(&gserver.cancel.cancelled) ? "cancelled" : "timeout",
+                 (unsigned long long)result->solutions, result->fraction * 100);
+}
+
+void reply_count(reply_buffer *reply, const int *date, const search_budget *budget)
+{
+    uint64_t count;
+
+    pthread_mutex_lock(&gserver.cache_lock);
+    bool cached = cache_get_count(gserver.results, date[0], date[1], date[2], &count);
+    pthread_mutex_unlock(&gserver.cache_lock);
+
+    if (!cached)
+    {
+        uint64_t board;
+        if (!tables_date_board(gserver.tables, date, &board))
+        {
+            reply_append(reply, "error invalid date");
+            return;
+        }
+
+        count = 0;
+        if (date_board(date, &board))
+        {
+            search_options options;
+            search_options_init(&options);
+            options.budget = *budget;
+            search_result result = engine_search(gserver.tables, board, &options);
+            if (result.expired)
+            {
+                reply_expired(reply, &result);
+                return;
+            }
+            count = result.solutions;
+        }
+
+        pthread_mutex_lock(&gserver.cache_lock);
+        cache_put_count(gserver.results, date[0], date[1], date[2], count);
+        pthread_mutex_unlock(&gserver.cache_lock);
+    }
+
+    reply_append(reply, "ok %llu", (unsigned long long)count);
+}
+
+void reply_exists(reply_buffer *reply, const int *date, const search_budget *budget)
+{
+    bool exists;
+
+    pthread_mutex_lock(&gserver.cache_lock);
+    bool cached = cache_get_exists(gserver.results, date[0], date[1], date[2], &exists);
+    pthread_mutex_unlock(&gserver.cache_lock);
+
+    if (!cached)
+    {
+        uint64_t board;
+        if (!tables_date_board(gserver.tables, date, &board))
+        {
+            reply_append(reply, "error invalid date");
+            return;
+        }
+
+        exists = false;
+        if (date_board(date, &board))
+        {
+            search_options options;
+            search_options_init(&options);
+            options.limit = 1;
+            options.budget = *budget;
+            search_result result = engine_search(gserver.tables, board, &options);
+            if (result.expired && result.solutions == 0)
+            {
+                reply_expired(reply, &result);
+                return;
+            }
+            exists = result.solutions > 0;
+        }
+
+        pthread_mutex_lock(&gserver.cache_lock);
+        cache_put_exists(gserver.results, date[0], date[1], date[2], exists);
+        pthread_mutex_unlock(&gserver.cache_lock);
+    }
+
+    reply_append(reply, "ok %d", exists ? 1 : 0);
+}
+
+static bool append_solution(const puzzle_tables *tables, const uint16_t *placements, void *data)
+{
+    reply_buffer *reply = (reply_buffer *)data;
+    const tables_header *header = tables->header;
+
+    // piece:variant:x:y for each piece, variants counted from the piece's first one
+    reply_append(reply, " ");
+    for (uint32_t i = 0; i < header->pieces; i++)
+    {
+        const placement *chosen = tables->placements + placements[i];
+        reply_append(reply, "%s%u:%u:%u:%u", i ? "," : "", i, chosen->variant - header->piece_variants[i], chosen->x, chosen->y);
+    }
+    return true;
+}
+
+void reply_solutions(reply_buffer *reply, const int *date, uint64_t limit, bool hint, const search_budget *budget)
+{
+    uint64_t board;
+    if (!tables_date_board(gserver.tables, date, &board))
+    {
+        reply_append(reply, "error invalid date");
+        return;
+    }
+
+    reply_buffer solutions = {NULL, 0, 0};
+    uint64_t count = 0;
+
+    // Whole solution lists cached by solver answer it without searching. They are stored in
+    // solver's printing order, the last solution found first, so they are read from the end to
+    // answer in search order as a search would.
+    pthread_mutex_lock(&gserver.cache_lock);
+    uint32_t cached_count;
+    int pieces;
+    const uint8_t *cached;
+    if (cache_get_solutions(gserver.results, date[0], date[1], date[2], &cached_count, &pieces, &cached) && pieces == (int)gserver.tables->header->pieces)
+    {
+        for (; count < cached_count && count < limit; count++)
+        {
+            reply_append(&solutions, " ");
+            for (int i = 0; i < pieces; i++)
+            {
+                const uint8_t *record = cached + ((cached_count - 1 - count) * pieces + i) * 3;
+                reply_append(&solutions, "%s%d:%u:%u:%u", i ? "," : "", i, record[0], record[1], record[2]);
+            }
+        }
+        pthread_mutex_unlock(&gserver.cache_lock);
+    }
+    else
+    {
+        pthread_mutex_unlock(&gserver.cache_lock);
+
+        if (date_board(date, &board))
+        {
+            search_options options;
+            search_options_init(&options);
+            options.limit = limit;
+            options.on_solution = append_solution;
+            options.data = &solutions;
+            options.budget = *budget;
+            search_result result = engine_search(gserver.tables, board, &options);
+            count = result.solutions;
+
+            // The solutions found in time are enough unless fewer than asked for
+            if (result.expired && count < limit)
+            {
+                reply_expired(reply, &result);
+                free(solutions.data);
+                return;
+            }
+        }
+    }
+
+    if (hint)
+    {
+        // The first piece of the first solution
+        if (count == 0)
+            reply_append(reply, "ok none");
+        else
+        {
+            char *end = strchr(solutions.data + 1, ',');
+            if (end != NULL)
+                *end = '\0';
+            reply_append(reply, "ok %s", solutions.data + 1);
+        }
+    }
+    else
+        reply_append(reply, "ok %llu%s", (unsigned long long)count, count ? solutions.data : "");
+
+    free(solutions.data);
+}
+
+void reply_complete(reply_buffer *reply, const int *date, const char *list, const search_budget *budget)
+{
+    uint64_t board;
+    uint16_t fixed[MAX_PIECES];
+    int fixed_count;
+    if (!tables_date_board(gserver.tables, date, &board))
+    {
+        reply_append(reply, "error invalid date");
+        return;
+    }
+    if (!tables_parse_placements(gserver.tables, list, fixed, &fixed_count))
+    {
+        reply_append(reply, "error invalid placements");
+        return;
+    }
+
+    // The pieces on the board are pre-masked, the fewest covering placements order finishes it fastest
+    search_options options;
+    search_options_init(&options);
+    options.fixed = fixed;
+    options.fixed_count = fixed_count;
+    if (!engine_check_fixed(gserver.tables, board, &options, 0))
+    {
+        reply_append(reply, "error conflicting placements");
+        return;
+    }
+
+    reply_buffer solution = {NULL, 0, 0};
+    search_result result = {0, 0, false, false, 0};
+    if (date_board(date, &board))
+    {
+        options.order = ORDER_CELL;
+        options.limit = 1;
+        options.on_solution = append_solution;
+        options.data = &solution;
+        options.budget = *budget;
+        result = engine_search(gserver.tables, board, &options);
+    }
+
+    if (result.expired && result.solutions == 0)
+        reply_expired(reply, &result);
+    else
+        reply_append(reply, "ok %llu%s", (unsigned long long)result.solutions, result.solutions ? solution.data : "");
+    free(solution.data);
+}
+
+void reply_moves(reply_buffer *reply, const int *date, const char *list, bool count, const search_budget *budget)
+{
+    const puzzle_tables *tables = gserver.tables;
+    uint64_t board;
+    uint16_t fixed[MAX_PIECES];
+    int fixed_count;
+    if (!tables_date_board(tables, date, &board))
+    {
+        reply_append(reply, "error invalid date");
+        return;
+    }
+    if (!tables_parse_placements(tables, list, fixed, &fixed_count))
+    {
+        reply_append(reply, "error invalid placements");
+        return;
+    }
+
+    search_options options;
+    search_options_init(&options);
+    options.fixed = fixed;
+    options.fixed_count = fixed_count;
+    if (!engine_check_fixed(tables, board, &options, 0))
+    {
+        reply_append(reply, "error conflicting placements");
+        return;
+    }
+    if (!date_board(date, &board))
+    {
+        reply_append(reply, "ok 0");
+        return;
+    }
+
+    uint32_t used = 0;
+    for (int i = 0; i < fixed_count; i++)
+    {
+        board |= tables->placements[fixed[i]].mask;
+        used |= 1u << tables->placements[fixed[i]].piece;
+    }
+
+    // Requests share the states already counted, one at a time since the table grows while they run
+    hint_move *moves = (hint_move *)malloc(sizeof(hint_move) * tables->header->placements);
+    pthread_mutex_lock(&gserver.hints_lock);
+    search_result result = hint_moves(&gserver.hints, board, used, budget, moves);
+    pthread_mutex_unlock(&gserver.hints_lock);
+
+    if (result.expired)
+        reply_append(reply, "error %s after %llu moves, %.1f%% checked", atomic_load(&gserver.cancel.cancelled) ? "cancelled" : "timeout",
+                     (unsigned long long)result.solutions, result.fraction * 100);
+    else
+    {
+        reply_append(reply, "ok %llu", (unsigned long long)result.solutions);
+        for (uint64_t i = 0; i < result.solutions; i++)
+        {
+            const placement *chosen = tables->placements + moves[i].placement;
+            reply_append(reply, " %u:%u:%u:%u", chosen->piece, chosen->variant - tables->header->piece_variants[chosen->piece], chosen->x, chosen->y);
+            if (count)
+                reply_append(reply, "=%llu", (unsigned long long)moves[i].completions);
+        }
+    }
+    free(moves);
+}
+
+void reply_stats(reply_buffer *reply)
+{
+    double p50, p99;
+    uint64_t requests;
+    latency_percentiles(&p50, &p99, &requests);
+    pthread_mutex_lock(&gserver.hints_lock);
+    uint64_t states = gserver.hints.states.stored, lookups = gserver.hints.lookups, hits = gserver.hints.hits;
+    pthread_mutex_unlock(&gserver.hints_lock);
+    reply_append(reply, "ok requests %llu p50_us %.1f p99_us %.1f hint_states %llu hint_hits %.1f%%", (unsigned long long)requests, p50, p99,
+                 (unsigned long long)states, lookups ? 100.0 * hits / lookups : 0);
+}
+
+char *handle_request(const char *line, const search_budget *budget)
+{
+    reply_buffer reply = {NULL, 0, 0};
+    char command[16];
+    int date[3];
+    unsigned long long limit;
+    char list[LINE_LENGTH];
+
+    if (sscanf(line, "%15s", command) != 1)
+        reply_append(&reply, "error empty request");
+    else if (strcmp(command, "count") == 0 && sscanf(line, "%*s %d %d %d", date, date + 1, date + 2) == 3)
+        reply_count(&reply, date, budget);
+    else if (strcmp(command, "exists") == 0 && sscanf(line, "%*s %d %d %d", date, date + 1, date + 2) == 3)
+        reply_exists(&reply, date, budget);
+    else if (strcmp(command, "first") == 0 && sscanf(line, "%*s %llu %d %d %d", &limit, date, date + 1, date + 2) == 4 && limit > 0)
+        reply_solutions(&reply, date, limit, false, budget);
+    else if (strcmp(command, "hint") == 0 && sscanf(line, "%*s %d %d %d", date, date + 1, date + 2) == 3)
+        reply_solutions(&reply, date, 1, true, budget);
+    else if (strcmp(command, "complete") == 0 && sscanf(line, "%*s %d %d %d %255s", date, date + 1, date + 2, list) == 4)
+        reply_complete(&reply, date, list, budget);
+    else if ((strcmp(command, "moves") == 0 || strcmp(command, "counts") == 0) && sscanf(line, "%*s %d %d %d", date, date + 1, date + 2) == 3)
+    {
+        // The placements are optional, the empty board's moves are the first ones
+        if (sscanf(line, "%*s %*d %*d %*d %255s", list) != 1)
+            list[0] = '\0';
+        reply_moves(&reply, date, list, strcmp(command, "counts") == 0, budget);
+    }
+    else if (strcmp(command, "stats") == 0)
+        reply_stats(&reply);
+    else
+        reply_append(&reply, "error unknown request");
+
+    return reply.data;
+}
+
+//-------------------------Statistics-------------------------
+
+void record_latency(const struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double latency = (end.tv_sec - start->tv_sec) * 1e6 + (end.tv_nsec - start->tv_nsec) / 1e3;
+
+    pthread_mutex_lock(&gserver.stats_lock);
+    gserver.latencies[gserver.requests % LATENCY_SAMPLES] = latency;
+    gserver.requests++;
+    pthread_mutex_unlock(&gserver.stats_lock);
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void latency_percentiles(double *p50, double *p99, uint64_t *requests)
+{
+    pthread_mutex_lock(&gserver.stats_lock);
+    *requests = gserver.requests;
+    size_t n = gserver.requests < LATENCY_SAMPLES ? gserver.requests : LATENCY_SAMPLES;
+    double *sorted = (double *)malloc(sizeof(double) * (n ? n : 1));
+    memcpy(sorted, gserver.latencies, sizeof(double) * n);
+    pthread_mutex_unlock(&gserver.stats_lock);
+
+    *p50 = *p99 = 0;
+    if (n > 0)
+    {
+        qsort(sorted, n, sizeof(double), compare_doubles);
+        *p50 = sorted[(n - 1) / 2];
+        *p99 = sorted[(n - 1) * 99 / 100];
+    }
+    free(sorted);
+}
+
+//-------------------------Worker pool-------------------------
+
+void submit(request *new_request)
+{
+    pthread_mutex_lock(&gserver.queue_lock);
+    new_request->next_queued = NULL;
+    if (gserver.queue_tail != NULL)
+        gserver.queue_tail->next_queued = new_request;
+    else
+        gserver.queue_head = new_request;
+    gserver.queue_tail = new_request;
+    pthread_cond_signal(&gserver.queue_cond);
+    pthread_mutex_unlock(&gserver.queue_lock);
+}
+
+void *worker(void *data)
+{
+    (void)data;
+    while (true)
+    {
+        pthread_mutex_lock(&gserver.queue_lock);
+        while (gserver.queue_head == NULL && !gserver.stopping)
+            pthread_cond_wait(&gserver.queue_cond, &gserver.queue_lock);
+        request *current = gserver.queue_head;
+        if (current == NULL)
+        {
+            pthread_mutex_unlock(&gserver.queue_lock);
+            return NULL;
+        }
+        gserver.queue_head = current->next_queued;
+        if (gserver.queue_head == NULL)
+            gserver.queue_tail = NULL;
+        pthread_mutex_unlock(&gserver.queue_lock);
+
+        // The time budget runs from the arrival of the request
+        search_budget budget;
+        budget.cancel = &gserver.cancel;
+        budget.deadline = gserver.timeout > 0 ? current->received.tv_sec + current->received.tv_nsec * 1e-9 + gserver.timeout : 0;
+        char *reply = handle_request(current->line, &budget);
+        record_latency(&current->received);
+
+        connection *client = current->connection;
+        pthread_mutex_lock(&client->lock);
+        current->reply = reply;
+        current->done = true;
+        pthread_cond_broadcast(&client->cond);
+        pthread_mutex_unlock(&client->lock);
+    }
+}
+
+//-------------------------Connections-------------------------
+
+void *connection_writer(void *data)
+{
+    connection *client = (connection *)data;
+
+    // Replies are written in request order, whichever worker finishes first
+    while (true)
+    {
+        pthread_mutex_lock(&client->lock);
+        while ((client->head == NULL && !client->closed) || (client->head != NULL && !client->head->done))
+            pthread_cond_wait(&client->cond, &client->lock);
+        request *current = client->head;
+        if (current == NULL)
+        {
+            pthread_mutex_unlock(&client->lock);
+            return NULL;
+        }
+        client->head = current->next;
+        if (client->head == NULL)
+            client->tail = NULL;
+        pthread_mutex_unlock(&client->lock);
+
+        fprintf(client->out, "%s\n", current->reply);
+        fflush(client->out);
+
+        free(current->reply);
+        free(current);
+    }
+}
+
+void serve_connection(connection *client)
+{
+    pthread_mutex_init(&client->lock, NULL);
+    pthread_cond_init(&client->cond, NULL);
+    client->head = client->tail = NULL;
+    client->closed = false;
+
+    pthread_t writer;
+    pthread_create(&writer, NULL, connection_writer, client);
+
+    // Requests are read as they come so that several of them can be solved at once
+    char line[LINE_LENGTH];
+    while (!gstop && fgets(line, LINE_LENGTH, client->in) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0')
+            continue;
+        if (strcmp(line, "quit") == 0)
+            break;
+
+        request *new_request = (request *)calloc(1, sizeof(request));
+        memcpy(new_request->line, line, LINE_LENGTH);
+        clock_gettime(CLOCK_MONOTONIC, &new_request->received);
+        new_request->connection = client;
+
+        pthread_mutex_lock(&client->lock);
+        if (client->tail != NULL)
+            client->tail->next = new_request;
+        else
+            client->head = new_request;
+        client->tail = new_request;
+        pthread_mutex_unlock(&client->lock);
+
+        submit(new_request);
+    }
+
+    pthread_mutex_lock(&client->lock);
+    client->closed = true;
+    pthread_cond_broadcast(&client->cond);
+    pthread_mutex_unlock(&client->lock);
+
+    pthread_join(writer, NULL);
+    pthread_cond_destroy(&client->cond);
+    pthread_mutex_destroy(&client->lock);
+}
+
+void *connection_thread(void *data)
+{
+    connection *client = (connection *)data;
+
+    client->in = fdopen(client->fd, "r");
+    client->out = fdopen(dup(client->fd), "w");
+    if (client->in != NULL && client->out != NULL)
+        serve_connection(client);
+
+    // The connection leaves the open ones before its socket is closed
+    pthread_mutex_lock(&gserver.connections_lock);
+    connection **link = &gserver.open_connections;
+    while (*link != client)
+        link = &(*link)->next_open;
+    *link = client->next_open;
+    gserver.open_count--;
+    pthread_cond_broadcast(&gserver.connections_cond);
+    pthread_mutex_unlock(&gserver.connections_lock);
+
+    if (client->in != NULL)
+        fclose(client->in);
+    else
+        close(client->fd);
+    if (client->out != NULL)
+        fclose(client->out);
+    free(client);
+    return NULL;
+}
+
+void close_connections()
+{
+    // Reading stops on every open connection, their requests are answered, then their threads end
+    pthread_mutex_lock(&gserver.connections_lock);
+    for (connection *client = gserver.open_connections; client != NULL; client = client->next_open)
+        shutdown(client->fd, SHUT_RD);
+    while (gserver.open_count > 0)
+        pthread_cond_wait(&gserver.connections_cond, &gserver.connections_lock);
+    pthread_mutex_unlock(&gserver.connections_lock);
+}
+
+int serve_socket(const char *path)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (fd < 0 || strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "Error : cannot create socket %s\n", path);
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 64) != 0)
+    {
+        fprintf(stderr, "Error : cannot listen on %s : %s\n", path, strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    fprintf(stderr, "Listening on %s\n", path);
+
+    // Poll so that a signal stops the server between two connections
+    struct pollfd listener = {fd, POLLIN, 0};
+    while (!gstop)
+    {
+        if (poll(&listener, 1, 200) <= 0)
+            continue;
+
+        int client_fd = accept(fd, NULL, NULL);
+        if (client_fd < 0)
+            continue;
+
+        // Registered before its thread starts, so that a shutdown right after still waits for it
+        connection *client = (connection *)calloc(1, sizeof(connection));
+        client->fd = client_fd;
+        pthread_mutex_lock(&gserver.connections_lock);
+        client->next_open = gserver.open_connections;
+        gserver.open_connections = client;
+        gserver.open_count++;
+        pthread_mutex_unlock(&gserver.connections_lock);
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, connection_thread, client) != 0)
+        {
+            pthread_mutex_lock(&gserver.connections_lock);
+            gserver.open_connections = client->next_open;
+            gserver.open_count--;
+            pthread_mutex_unlock(&gserver.connections_lock);
+            close(client_fd);
+            free(client);
+        }
+        else
+            pthread_detach(thread);
+    }
+
+    close(fd);
+    close_connections();
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "states.h"
+
+static uint64_t state_hash(const uint64_t free_cells, const uint32_t used)
+{
+    // splitmix64 finalizer
+    uint64_t key = free_cells ^ ((uint64_t)used << 48) ^ used;
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBULL;
+    key ^= key >> 31;
+    return key;
+}
+
+static state_entry *find_state(const state_table *table, const uint64_t free_cells, const uint32_t used)
+{
+    // The slot of the state, or the empty slot where it would go
+    uint64_t i = state_hash(free_cells, used) & table->size_mask;
+    while (table->entries[i].free_cells != 0)
+    {
+        if (table->entries[i].free_cells == free_cells && (table->entries[i].used_count & 0xFFFF) == used)
+            break;
+        i = (i + 1) & table->size_mask;
+    }
+    return table->entries + i;
+}
+
+static void grow_states(state_table *table)
+{
+    uint64_t slots = (table->size_mask + 1) * 2;
+    state_entry *entries = (state_entry *)calloc(slots, sizeof(state_entry));
+    if (entries == NULL)
+    {
+        table->max_slots = table->size_mask + 1;
+        return;
+    }
+
+    state_entry *old = table->entries;
+    uint64_t old_slots = table->size_mask + 1;
+    table->entries = entries;
+    table->size_mask = slots - 1;
+    for (uint64_t i = 0; i < old_slots; i++)
+        if (old[i].free_cells != 0)
+            *find_state(table, old[i].free_cells, old[i].used_count & 0xFFFF) = old[i];
+    free(old);
+}
+
+bool states_init(state_table *table, const size_t memory)
+{
+    uint64_t max_slots = 1024;
+    while (max_slots * 2 * sizeof(state_entry) <= memory)
+        max_slots *= 2;
+    uint64_t slots = max_slots < 65536 ? max_slots : 65536;
+
+    memset(table, 0, sizeof(state_table));
+    table->entries = (state_entry *)calloc(slots, sizeof(state_entry));
+    if (table->entries == NULL)
+        return false;
+    table->size_mask = slots - 1;
+    table->max_slots = max_slots;
+    return true;
+}
+
+void states_free(state_table *table)
+{
+    free(table->entries);
+    table->entries = NULL;
+}
+
+bool states_get(const state_table *table, const uint64_t free_cells, const uint32_t used, uint64_t *count)
+{
+    const state_entry *entry = find_state(table, free_cells, used);
+    if (entry->free_cells == 0)
+        return false;
+    *count = entry->used_count >> 16;
+    return true;
+}
+
+void states_put(state_table *table, const uint64_t free_cells, const uint32_t used, const uint64_t count)
+{
+    // Half full at most, so that probes stay short
+    if (table->stored * 2 >= table->size_mask + 1 && table->size_mask + 1 < table->max_slots)
+        grow_states(table);
+
+    // The slot may have been taken by a state stored deeper in the recursion
+    if (table->stored * 2 < table->size_mask + 1)
+    {
+        state_entry *entry = find_state(table, free_cells, used);
+        entry->free_cells = free_cells;
+        entry->used_count = count << 16 | used;
+        table->stored++;
+    }
+}
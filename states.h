@@ -0,0 +1,35 @@
+#ifndef STATES_H
+#define STATES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A state takes 16 bytes : the free cells, never 0 for a stored state, then the used pieces in the
+// low 16 bits and the count above them
+typedef struct state_entry
+{
+    uint64_t free_cells;
+    uint64_t used_count;
+} state_entry;
+
+// Counts of the states of a row-major count, a state being the free cells plus the set of used
+// pieces, in an open-addressing table. The table starts small and doubles until it reaches its
+// memory bound, then new states are counted without being stored.
+typedef struct state_table
+{
+    state_entry *entries;
+    uint64_t size_mask;
+    uint64_t stored, max_slots;
+} state_table;
+
+bool states_init(state_table *table, const size_t memory);
+void states_free(state_table *table);
+
+// Whether the state is stored, and its count if so
+bool states_get(const state_table *table, const uint64_t free_cells, const uint32_t used, uint64_t *count);
+
+// Stores the count of a state which wasn't found, nothing once the table is full
+void states_put(state_table *table, const uint64_t free_cells, const uint32_t used, const uint64_t count);
+
+#endif
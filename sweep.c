@@ -0,0 +1,676 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "tables.h"
+#include "engine.h"
+#include "cache.h"
+#include "schedule.h"
+#include "trace.h"
+
+#define LINE_LENGTH 1024
+#define MAX_WORKERS 256
+
+// Expensive dates are split for about this many cores by default
+#define DEFAULT_WORKERS 64
+
+typedef enum unit_state
+{
+    UNIT_PENDING,
+    UNIT_LEASED,
+    UNIT_DONE
+} unit_state;
+
+// A date, or the subtree of a date below the placements of its first pieces
+typedef struct work_unit
+{
+    int date_index;
+    int depth;
+    uint16_t prefix[MAX_PIECES];
+
+    unit_state state;
+    int worker;
+    time_t deadline;
+    double leased_at; // On trace_clock(), when tracing
+    uint64_t solutions, nodes;
+} work_unit;
+
+typedef struct sweep_date
+{
+    int date[3];
+    bool cached;
+    uint64_t solutions;
+} sweep_date;
+
+typedef struct worker_connection
+{
+    int fd;
+    char buffer[LINE_LENGTH];
+    size_t length;
+    int unit; // Leased unit, -1 if none
+    int lane; // Join order, the worker's lane in the trace
+    bool checked; // Its puzzle hash matched, nothing is accepted from it before
+} worker_connection;
+
+typedef struct coordinator
+{
+    const puzzle_tables *tables;
+    cache *results;
+    int lease_seconds;
+
+    sweep_date *dates;
+    int date_count;
+    work_unit *units;
+    int unit_count, units_done;
+
+    worker_connection workers[MAX_WORKERS];
+    int worker_count, workers_joined;
+    bool failed; // A worker couldn't solve a unit, the sweep stops
+} coordinator;
+
+// Command line
+void usage();
+puzzle_tables *load_tables(const char *puzzle_path);
+
+// Work units
+int read_dates(coordinator *c, const char *path);
+void make_units(coordinator *c, int workers, const char *timings_path);
+
+// Coordinator
+int listen_on(const char *host, int port);
+void send_unit(coordinator *c, worker_connection *worker);
+bool handle_line(coordinator *c, worker_connection *worker, char *line);
+void drop_worker(coordinator *c, int index);
+void expire_leases(coordinator *c);
+int run_coordinator(const char *puzzle_path, const char *host, int port, const char *dates_path, const char *timings_path, int workers, int lease_seconds, const char *trace_path);
+
+// Worker
+int connect_to(const char *address);
+int run_worker(const char *puzzle_path, const char *address, int jobs);
+
+void usage()
+{
+    fprintf(stderr, "Usage: ./sweep coordinator [options]\n"
+                    "       ./sweep worker --connect HOST:PORT [options]\n"
+                    "  -p, --puzzle FILE   puzzle definition or compiled puzzle\n"
+                    "  -P, --port PORT     coordinator port (default 5555)\n"
+                    "  -L, --listen ADDR   IPv4 address the coordinator listens on (default 127.0.0.1), workers\n"
+                    "                      aren't authenticated so only open it on a trusted network\n"
+                    "  -d, --dates FILE    only sweep the \"month day week_day\" lines of FILE\n"
+                    "  -w, --workers N     cores expected over all workers, dates above 1/8 of a core's share\n"
+                    "                      of the sweep are split into prefix units (default 64)\n"
+                    "  -t, --timings FILE  costs from the \"month;day;week_day;solutions;seconds\" lines of ./days\n"
+                    "  -T, --trace FILE    write the units of every worker as Chrome trace events to FILE\n"
+                    "  -l, --lease SECONDS lease length before a unit is handed out again (default 600)\n"
+                    "  -c, --connect ADDR  coordinator address for workers\n"
+                    "  -j, --jobs N        threads per worker\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+        usage();
+
+    const char *mode = argv[1];
+    const char *puzzle_path = NULL;
+    const char *dates_path = NULL;
+    const char *address = NULL;
+    const char *host = "127.0.0.1";
+    int port = 5555;
+    const char *timings_path = NULL;
+    const char *trace_path = NULL;
+    int workers = DEFAULT_WORKERS;
+    int lease_seconds = 600;
+    int jobs = 1;
+
+    static const struct option long_options[] = {
+        {"puzzle", required_argument, NULL, 'p'},
+        {"port", required_argument, NULL, 'P'},
+        {"listen", required_argument, NULL, 'L'},
+        {"dates", required_argument, NULL, 'd'},
+        {"workers", required_argument, NULL, 'w'},
+        {"timings", required_argument, NULL, 't'},
+        {"trace", required_argument, NULL, 'T'},
+        {"lease", required_argument, NULL, 'l'},
+        {"connect", required_argument, NULL, 'c'},
+        {"jobs", required_argument, NULL, 'j'},
+        {NULL, 0, NULL, 0}};
+
+    int option;
+    optind = 2;
+    while ((option = getopt_long(argc, argv, "p:P:L:d:w:t:T:l:c:j:", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'p':
+            puzzle_path = optarg;
+            break;
+        case 'P':
+            port = atoi(optarg);
+            break;
+        case 'L':
+            host = optarg;
+            break;
+        case 'd':
+            dates_path = optarg;
+            break;
+        case 'w':
+            workers = atoi(optarg);
+            break;
+        case 't':
+            timings_path = optarg;
+            break;
+        case 'T':
+            trace_path = optarg;
+            break;
+        case 'l':
+            lease_seconds = atoi(optarg);
+            break;
+        case 'c':
+            address = optarg;
+            break;
+        case 'j':
+            jobs = atoi(optarg);
+            break;
+        default:
+            usage();
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if (strcmp(mode, "coordinator") == 0)
+        return run_coordinator(puzzle_path, host, port, dates_path, timings_path, workers, lease_seconds, trace_path);
+    if (strcmp(mode, "worker") == 0 && address != NULL)
+        return run_worker(puzzle_path, address, jobs);
+    usage();
+}
+
+puzzle_tables *load_tables(const char *puzzle_path)
+{
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    if (!tables_check_dates(tables))
+        exit(1);
+    return tables;
+}
+
+//-------------------------Work units-------------------------
+
+int read_dates(coordinator *c, const char *path)
+{
+    int capacity = tables_date_range(c->tables, 0) * tables_date_range(c->tables, 1) * tables_date_range(c->tables, 2);
+    c->dates = (sweep_date *)calloc(capacity + 1, sizeof(sweep_date));
+
+    if (path == NULL)
+    {
+        // The whole year
+        for (int i = 0; i < tables_date_range(c->tables, 0); i++)
+            for (int j = 0; j < tables_date_range(c->tables, 1); j++)
+                for (int k = 0; k < tables_date_range(c->tables, 2); k++)
+                {
+                    sweep_date *date = c->dates + c->date_count++;
+                    date->date[0] = i;
+                    date->date[1] = j;
+                    date->date[2] = k;
+                }
+        return 0;
+    }
+
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error : cannot open %s\n", path);
+        return 1;
+    }
+
+    char line[LINE_LENGTH];
+    int date[3];
+    uint64_t board;
+    while (fgets(line, LINE_LENGTH, fp) != NULL && c->date_count < capacity)
+        if (sscanf(line, "%d %d %d", date, date + 1, date + 2) == 3 && tables_date_board(c->tables, date, &board))
+            memcpy(c->dates[c->date_count++].date, date, sizeof(date));
+
+    fclose(fp);
+    return 0;
+}
+
+void make_units(coordinator *c, int workers, const char *timings_path)
+{
+    // Cached dates need no work, the others are scheduled longest first, see schedule_dates
+    int (*pending)[3] = (int (*)[3])malloc(sizeof(int[3]) * (c->date_count + 1));
+    int *indexes = (int *)malloc(sizeof(int) * (c->date_count + 1));
+    int to_solve = 0;
+    for (int i = 0; i < c->date_count; i++)
+    {
+        sweep_date *date = c->dates + i;
+        uint64_t board;
+        tables_date_board(c->tables, date->date, &board);
+
+        date->cached = cache_get_count(c->results, date->date[0], date->date[1], date->date[2], &date->solutions);
+        if (!date->cached && tables_free_cells(c->tables, board) != tables_pieces_area(c->tables))
+        {
+            date->cached = true;
+            date->solutions = 0;
+        }
+        if (date->cached)
+            continue;
+
+        memcpy(pending[to_solve], date->date, sizeof(date->date));
+        indexes[to_solve++] = i;
+    }
+
+    double *timings = timings_path != NULL ? schedule_read_timings(c->tables, timings_path) : NULL;
+    schedule_job *jobs;
+    c->unit_count = schedule_dates(c->tables, (const int (*)[3])pending, to_solve, timings, workers, &jobs);
+
+    c->units = (work_unit *)calloc(c->unit_count + 1, sizeof(work_unit));
+    for (int i = 0; i < c->unit_count; i++)
+    {
+        work_unit *unit = c->units + i;
+        unit->date_index = indexes[jobs[i].date_index];
+        unit->depth = jobs[i].depth;
+        memcpy(unit->prefix, jobs[i].prefix, sizeof(unit->prefix));
+    }
+
+    free(jobs);
+    free(timings);
+    free(indexes);
+    free(pending);
+}
+
+//-------------------------Coordinator-------------------------
+
+int listen_on(const char *host, int port)
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &address.sin_addr) != 1)
+    {
+        fprintf(stderr, "Error : %s isn't an IPv4 address\n", host);
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 64) != 0)
+    {
+        fprintf(stderr, "Error : cannot listen on %s:%d : %s\n", host, port, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void send_unit(coordinator *c, worker_connection *worker)
+{
+    // Units are handed out in order, hardest dates first
+    for (int i = 0; i < c->unit_count; i++)
+    {
+        work_unit *unit = c->units + i;
+        if (unit->state != UNIT_PENDING)
+            continue;
+
+        unit->state = UNIT_LEASED;
+        unit->worker = worker - c->workers;
+        unit->deadline = time(NULL) + c->lease_seconds;
+        unit->leased_at = trace_enabled() ? trace_clock() : 0;
+        worker->unit = i;
+
+        const int *date = c->dates[unit->date_index].date;
+        char line[LINE_LENGTH];
+        int n = snprintf(line, LINE_LENGTH, "unit %d %d %d %d %d", i, date[0], date[1], date[2], unit->depth);
+        for (int d = 0; d < unit->depth; d++)
+            n += snprintf(line + n, LINE_LENGTH - n, " %u", unit->prefix[d]);
+        snprintf(line + n, LINE_LENGTH - n, "\n");
+        if (write(worker->fd, line, strlen(line)) < 0)
+            worker->unit = -1;
+        return;
+    }
+
+    // Everything is leased, the worker asks again later in case a lease is given back
+    worker->unit = -1;
+    if (write(worker->fd, "wait\n", 5) < 0)
+        return;
+}
+
+// Returns false when the worker must be dropped
+bool handle_line(coordinator *c, worker_connection *worker, char *line)
+{
+    int id;
+    unsigned long long solutions, nodes, hash;
+
+    // Workers announce the hash of their tables, the counts of another puzzle or piece order would
+    // be merged silently otherwise
+    if (sscanf(line, "ready %llx", &hash) == 1)
+    {
+        if (hash != c->tables->header->hash)
+        {
+            fprintf(stderr, "Error : worker %d runs another puzzle (hash %016llx), refused\n", (int)(worker - c->workers), hash);
+            // The worker stops on its own whether or not it reads this
+            if (write(worker->fd, "refused\n", 8) < 0)
+                fprintf(stderr, "Error : cannot tell worker %d : %s\n", (int)(worker - c->workers), strerror(errno));
+            return false;
+        }
+        worker->checked = true;
+        send_unit(c, worker);
+    }
+    else if (!worker->checked)
+    {
+        fprintf(stderr, "Error : worker %d didn't send its puzzle hash, refused\n", (int)(worker - c->workers));
+        return false;
+    }
+    else if (sscanf(line, "result %d %llu %llu", &id, &solutions, &nodes) == 3 && id >= 0 && id < c->unit_count)
+    {
+        // The first result of a unit wins, late duplicates of expired leases are ignored
+        work_unit *unit = c->units + id;
+        if (trace_enabled() && worker->unit == id)
+        {
+            const int *date = c->dates[unit->date_index].date;
+            trace_task task = {{date[0], date[1], date[2]}, id, unit->depth, solutions, nodes};
+            trace_record(unit->state == UNIT_DONE ? "duplicate" : "unit", worker->lane, unit->leased_at, &task);
+        }
+        if (unit->state != UNIT_DONE)
+        {
+            unit->state = UNIT_DONE;
+            unit->solutions = solutions;
+            unit->nodes = nodes;
+            c->units_done++;
+            if (c->units_done % 100 == 0 || c->units_done == c->unit_count)
+                fprintf(stderr, "%d/%d units done\n", c->units_done, c->unit_count);
+        }
+        if (worker->unit == id)
+            worker->unit = -1;
+        send_unit(c, worker);
+    }
+    else if (sscanf(line, "error %d", &id) == 1)
+    {
+        // Both sides have the same tables, so another worker would fail the same way
+        fprintf(stderr, "Error : worker %d couldn't solve unit %d : %s\n", (int)(worker - c->workers), id, line);
+        c->failed = true;
+    }
+    return true;
+}
+
+void drop_worker(coordinator *c, int index)
+{
+    worker_connection *worker = c->workers + index;
+
+    // Its lease goes back to the pending units
+    if (worker->unit >= 0 && c->units[worker->unit].state == UNIT_LEASED && c->units[worker->unit].worker == index)
+        c->units[worker->unit].state = UNIT_PENDING;
+
+    close(worker->fd);
+    fprintf(stderr, "Worker %d left\n", index);
+
+    // Keep the array packed, leases follow the moved worker
+    int last = c->worker_count - 1;
+    if (index != last)
+    {
+        c->workers[index] = c->workers[last];
+        for (int i = 0; i < c->unit_count; i++)
+            if (c->units[i].state == UNIT_LEASED && c->units[i].worker == last)
+                c->units[i].worker = index;
+    }
+    c->worker_count--;
+}
+
+void expire_leases(coordinator *c)
+{
+    time_t now = time(NULL);
+    for (int i = 0; i < c->unit_count; i++)
+    {
+        work_unit *unit = c->units + i;
+        if (unit->state == UNIT_LEASED && unit->deadline < now)
+        {
+            fprintf(stderr, "Lease of unit %d expired\n", i);
+            unit->state = UNIT_PENDING;
+        }
+    }
+}
+
+int run_coordinator(const char *puzzle_path, const char *host, int port, const char *dates_path, const char *timings_path, int workers, int lease_seconds, const char *trace_path)
+{
+    coordinator c;
+    memset(&c, 0, sizeof(c));
+    c.tables = load_tables(puzzle_path);
+    c.results = cache_open(c.tables->header->hash);
+    c.lease_seconds = lease_seconds > 0 ? lease_seconds : 1;
+
+    if (read_dates(&c, dates_path) != 0)
+        return 1;
+    make_units(&c, workers, timings_path);
+    if (trace_path != NULL && !trace_open(trace_path))
+        return 1;
+
+    int listener = listen_on(host, port);
+    if (listener < 0)
+        return 1;
+    fprintf(stderr, "Coordinating %d dates in %d units on %s:%d\n", c.date_count, c.unit_count, host, port);
+
+    struct pollfd fds[MAX_WORKERS + 1];
+    while (c.units_done < c.unit_count && !c.failed)
+    {
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < c.worker_count; i++)
+        {
+            fds[i + 1].fd = c.workers[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+
+        int ready = poll(fds, c.worker_count + 1, 1000);
+        expire_leases(&c);
+        if (ready <= 0)
+            continue;
+
+        // Workers are read from the last one so that dropping one doesn't skip another
+        for (int i = c.worker_count - 1; i >= 0; i--)
+        {
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+
+            worker_connection *worker = c.workers + i;
+            ssize_t n = read(worker->fd, worker->buffer + worker->length, LINE_LENGTH - 1 - worker->length);
+            if (n <= 0)
+            {
+                drop_worker(&c, i);
+                continue;
+            }
+            worker->length += n;
+            worker->buffer[worker->length] = '\0';
+
+            char *line = worker->buffer;
+            char *end;
+            bool keep = true;
+            while (keep && (end = strchr(line, '\n')) != NULL)
+            {
+                *end = '\0';
+                keep = handle_line(&c, worker, line);
+                line = end + 1;
+            }
+            if (!keep)
+            {
+                drop_worker(&c, i);
+                continue;
+            }
+            worker->length = strlen(line);
+            memmove(worker->buffer, line, worker->length + 1);
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            int fd = accept(listener, NULL, NULL);
+            if (fd >= 0 && c.worker_count < MAX_WORKERS)
+            {
+                worker_connection *worker = c.workers + c.worker_count++;
+                memset(worker, 0, sizeof(worker_connection));
+                worker->fd = fd;
+                worker->unit = -1;
+                worker->lane = c.workers_joined++;
+                fprintf(stderr, "Worker %d joined\n", c.worker_count - 1);
+            }
+            else if (fd >= 0)
+                close(fd);
+        }
+    }
+
+    // Counts are merged per date and printed in date order, whatever the order of the results. A
+    // failed sweep prints nothing, its counts would be partial.
+    for (int i = 0; i < c.unit_count; i++)
+        c.dates[c.units[i].date_index].solutions += c.units[i].solutions;
+
+    for (int i = 0; i < c.date_count && !c.failed; i++)
+    {
+        sweep_date *date = c.dates + i;
+        if (!date->cached)
+            cache_put_count(c.results, date->date[0], date->date[1], date->date[2], date->solutions);
+        printf("%d;%d;%d;%llu\n", date->date[0], date->date[1], date->date[2], (unsigned long long)date->solutions);
+    }
+
+    // Closing the connections tells the workers to stop
+    for (int i = 0; i < c.worker_count; i++)
+        close(c.workers[i].fd);
+    close(listener);
+
+    trace_close();
+    cache_close(c.results);
+    tables_free((puzzle_tables *)c.tables);
+    free(c.units);
+    free(c.dates);
+    return c.failed ? 1 : 0;
+}
+
+//-------------------------Worker-------------------------
+
+int connect_to(const char *address)
+{
+    char host[256];
+    const char *colon = strrchr(address, ':');
+    if (colon == NULL || colon - address >= (long)sizeof(host))
+        return -1;
+    memcpy(host, address, colon - address);
+    host[colon - address] = '\0';
+
+    struct addrinfo hints, *found;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, colon + 1, &hints, &found) != 0)
+        return -1;
+
+    int fd = -1;
+    for (struct addrinfo *a = found; a != NULL && fd < 0; a = a->ai_next)
+    {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(found);
+    return fd;
+}
+
+int run_worker(const char *puzzle_path, const char *address, int jobs)
+{
+    puzzle_tables *tables = load_tables(puzzle_path);
+
+    int fd = connect_to(address);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error : cannot connect to %s\n", address);
+        return 1;
+    }
+
+    FILE *in = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    unsigned long long hash = tables->header->hash;
+    fprintf(out, "ready %016llx\n", hash);
+    fflush(out);
+
+    search_options options;
+    search_options_init(&options);
+    options.jobs = jobs;
+
+    // Runs until the coordinator closes the connection
+    char line[LINE_LENGTH];
+    int units = 0, status = 0;
+    while (fgets(line, LINE_LENGTH, in) != NULL)
+    {
+        int id = -1, date[3], depth = 0, offset = 0;
+        if (strncmp(line, "wait", 4) == 0)
+        {
+            sleep(1);
+            fprintf(out, "ready %016llx\n", hash);
+            fflush(out);
+            continue;
+        }
+        if (strncmp(line, "refused", 7) == 0)
+        {
+            fprintf(stderr, "Error : the coordinator runs another puzzle or piece order\n");
+            status = 1;
+            break;
+        }
+        bool valid = sscanf(line, "unit %d %d %d %d %d%n", &id, date, date + 1, date + 2, &depth, &offset) == 5 && depth >= 0 &&
+                     depth <= (int)tables->header->pieces;
+
+        // The engine counts 0 for a prefix which isn't the one of piece d at depth d, or whose
+        // placements overlap, so such a unit is an error rather than a count
+        uint64_t board = 0;
+        bool dated = valid && tables_date_board(tables, date, &board);
+        uint64_t covered = board;
+        uint16_t prefix[MAX_PIECES];
+        const char *rest = line + offset;
+        for (int d = 0; d < depth && valid && dated; d++)
+        {
+            int n = 0;
+            unsigned value;
+            valid = sscanf(rest, "%u%n", &value, &n) == 1 && value < tables->header->placements &&
+                    tables->placements[value].piece == d && !(covered & tables->placements[value].mask);
+            prefix[d] = value;
+            covered |= valid ? tables->placements[value].mask : 0;
+            rest += n;
+        }
+        const char *error = !valid ? "malformed unit" : !dated ? "not a date of this puzzle" : NULL;
+        if (error != NULL)
+        {
+            fprintf(stderr, "Error : %s from the coordinator : %s", error, line);
+            fprintf(out, "error %d %s\n", id, error);
+            fflush(out);
+            status = 1;
+            continue;
+        }
+
+        search_result result = engine_search_from(tables, board, prefix, depth, &options);
+        fprintf(out, "result %d %llu %llu\n", id, (unsigned long long)result.solutions, (unsigned long long)result.nodes);
+        fflush(out);
+        units++;
+    }
+
+    fprintf(stderr, "Solved %d units\n", units);
+    fclose(in);
+    fclose(out);
+    tables_free(tables);
+    return status;
+}
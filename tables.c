@@ -0,0 +1,967 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tables.h"
+
+#define LINE_LENGTH 256
+#define ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+typedef struct definition
+{
+    int height, width;
+    bool mirror;
+    char layout[8][9];
+    char group_names[MAX_GROUPS];
+    int groups;
+    char any_names[MAX_GROUPS]; // Groups of which any cell is left uncovered
+    int anys;
+    shapes_list *pieces;
+    int piece_count;
+} definition;
+
+//-------------------------Hashing-------------------------
+
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t length)
+{
+    // FNV-1a, start from 0xcbf29ce484222325
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_tables(const puzzle_tables *tables)
+{
+    const tables_header *header = tables->header;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    // Geometry, blocked cells and target groups
+    hash = hash_bytes(hash, &header->height, sizeof(header->height));
+    hash = hash_bytes(hash, &header->width, sizeof(header->width));
+    hash = hash_bytes(hash, &header->blocked, sizeof(header->blocked));
+    hash = hash_bytes(hash, &header->mirror, sizeof(header->mirror));
+    hash = hash_bytes(hash, &header->groups, sizeof(header->groups));
+    hash = hash_bytes(hash, header->group_start, sizeof(header->group_start));
+    hash = hash_bytes(hash, header->group_cells, header->group_start[header->groups]);
+
+    // Pieces, through their normalized variants
+    hash = hash_bytes(hash, &header->pieces, sizeof(header->pieces));
+    hash = hash_bytes(hash, header->piece_variants, sizeof(uint32_t) * (header->pieces + 1));
+    for (uint32_t i = 0; i < header->pieces; i++)
+        if (header->piece_cells[i] != 0)
+            hash = hash_bytes(hash, header->piece_cells + i, sizeof(uint64_t));
+    for (uint32_t i = 0; i < header->variants; i++)
+    {
+        const variant_entry *variant = tables->variants + i;
+        hash = hash_bytes(hash, &variant->height, 1);
+        hash = hash_bytes(hash, &variant->width, 1);
+        hash = hash_bytes(hash, variant->rows, variant->height);
+    }
+
+    return hash;
+}
+
+static uint32_t build_indexes(tables_header *header, const placement *placements, uint16_t *anchored, uint16_t *covering)
+{
+    // Per cell indexes, returns the length of the covering one
+    uint32_t a = 0, c = 0;
+    for (int cell = 0; cell < 64; cell++)
+    {
+        header->anchored_start[cell] = a;
+        header->covering_start[cell] = c;
+        for (uint32_t i = 0; i < header->placements; i++)
+        {
+            if (placements[i].cell == cell)
+                anchored[a++] = i;
+            if (placements[i].mask & (1ULL << cell))
+                covering[c++] = i;
+        }
+    }
+    header->anchored_start[64] = a;
+    header->covering_start[64] = c;
+    return c;
+}
+
+//-------------------------Definition parsing-------------------------
+
+static char *next_line(FILE *fp, char *line, int *line_number)
+{
+    // Skips empty lines and comments, layout and piece rows are read directly
+    while (fgets(line, LINE_LENGTH, fp) != NULL)
+    {
+        (*line_number)++;
+        if (line[strspn(line, " \t")] == '#')
+            continue;
+
+        size_t length = strlen(line);
+        while (length > 0 && isspace((unsigned char)line[length - 1]))
+            line[--length] = '\0';
+        if (length > 0)
+            return line;
+    }
+    return NULL;
+}
+
+static int read_row(const char *line, char *row, int width)
+{
+    // Cells may or may not be separated by spaces
+    int n = 0;
+    for (const char *c = line; *c != '\0'; c++)
+    {
+        if (isspace((unsigned char)*c))
+            continue;
+        if (n == width)
+            return -1;
+        row[n++] = *c;
+    }
+    return n;
+}
+
+static void free_definition(definition *def)
+{
+    if (def->pieces != NULL)
+        free_list(def->pieces);
+}
+
+static bool parse_definition(const char *path, definition *def)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error : cannot open the puzzle definition %s\n", path);
+        return false;
+    }
+
+    memset(def, 0, sizeof(definition));
+
+    char line[LINE_LENGTH];
+    int line_number = 0;
+    bool has_layout = false;
+    bool ok = true;
+
+    while (ok && next_line(fp, line, &line_number) != NULL)
+    {
+        char keyword[16];
+        int offset = 0;
+        if (sscanf(line, "%15s %n", keyword, &offset) != 1)
+            continue;
+        const char *arguments = line + offset;
+
+        if (strcmp(keyword, "board") == 0)
+        {
+            if (sscanf(arguments, "%d %d", &def->height, &def->width) != 2 || def->height < 1 || def->height > 8 || def->width < 1 || def->width > 8)
+                ok = false;
+        }
+        else if (strcmp(keyword, "layout") == 0)
+        {
+            if (def->height == 0)
+            {
+                ok = false;
+                break;
+            }
+            for (int y = 0; ok && y < def->height; y++)
+            {
+                char row[9] = {0};
+                if (fgets(line, LINE_LENGTH, fp) == NULL || read_row(line, row, def->width) != def->width)
+                    ok = false;
+                else
+                    memcpy(def->layout[y], row, 9);
+                line_number++;
+            }
+            has_layout = ok;
+        }
+        else if (strcmp(keyword, "groups") == 0 || strcmp(keyword, "any") == 0)
+        {
+            bool any = keyword[0] == 'a';
+            char *names = any ? def->any_names : def->group_names;
+            int *count = any ? &def->anys : &def->groups;
+            for (const char *c = arguments; *c != '\0'; c++)
+            {
+                if (isspace((unsigned char)*c))
+                    continue;
+                if (*count == MAX_GROUPS || *c == '#' || *c == '.' || memchr(def->group_names, *c, def->groups) != NULL || memchr(def->any_names, *c, def->anys) != NULL)
+                {
+                    ok = false;
+                    break;
+                }
+                names[(*count)++] = *c;
+            }
+        }
+        else if (strcmp(keyword, "mirror") == 0)
+        {
+            def->mirror = atoi(arguments) != 0;
+        }
+        else if (strcmp(keyword, "piece") == 0)
+        {
+            int height, width;
+            if (def->piece_count == MAX_PIECES || sscanf(arguments, "%d %d", &height, &width) != 2 || height < 1 || height > 8 || width < 1 || width > 8)
+            {
+                ok = false;
+                break;
+            }
+
+            shapes *shape = (shapes *)malloc(sizeof(shapes));
+            shape->height = height;
+            shape->width = width;
+            shape->next = NULL;
+            shape->mask = (uint8_t *)calloc(height, sizeof(uint8_t));
+
+            for (int y = 0; ok && y < height; y++)
+            {
+                char row[9] = {0};
+                if (fgets(line, LINE_LENGTH, fp) == NULL || read_row(line, row, width) != width)
+                    ok = false;
+                line_number++;
+                for (int x = 0; ok && x < width; x++)
+                    if (row[x] != '0' && row[x] != '.')
+                        shape->mask[y] |= 1U << x;
+            }
+
+            if (!ok)
+            {
+                free_shapes(shape);
+                break;
+            }
+
+            // The rotations (and flips) are added once the mirror setting is known
+            if (def->pieces == NULL)
+            {
+                def->pieces = (shapes_list *)malloc(sizeof(shapes_list));
+                def->pieces->shapes = shape;
+                def->pieces->next = NULL;
+            }
+            else
+            {
+                shapes_list *last = def->pieces;
+                while (last->next != NULL)
+                    last = last->next;
+                last->next = (shapes_list *)malloc(sizeof(shapes_list));
+                last->next->shapes = shape;
+                last->next->next = NULL;
+            }
+            def->piece_count++;
+        }
+        else
+            ok = false;
+    }
+
+    fclose(fp);
+
+    if (!ok || !has_layout || def->piece_count == 0 || def->piece_count + def->anys > MAX_PIECES)
+    {
+        fprintf(stderr, "Error : invalid puzzle definition %s near line %d\n", path, line_number);
+        free_definition(def);
+        return false;
+    }
+
+    // Every layout letter must name a group
+    for (int y = 0; y < def->height; y++)
+        for (int x = 0; x < def->width; x++)
+        {
+            char c = def->layout[y][x];
+            if (c != '#' && c != '.' && memchr(def->group_names, c, def->groups) == NULL && memchr(def->any_names, c, def->anys) == NULL)
+            {
+                fprintf(stderr, "Error : cell '%c' of %s isn't a group\n", c, path);
+                free_definition(def);
+                return false;
+            }
+        }
+
+    return true;
+}
+
+//-------------------------Tables generation-------------------------
+
+static bool placement_fits(const uint64_t mask, const uint64_t blocked, const uint64_t kept)
+{
+    return !(mask & blocked) && (kept == 0 || !(mask & ~kept));
+}
+
+static puzzle_tables *build_tables(definition *def)
+{
+    // Variants come from the same rotation code as the original solver, so they keep its order
+    shapes_list *all = (shapes_list *)malloc(sizeof(shapes_list));
+    all->shapes = NULL;
+    all->next = NULL;
+
+    shapes_list *piece = def->pieces;
+    while (piece != NULL)
+    {
+        add_shapes(piece->shapes, all, def->mirror);
+        piece->shapes = NULL;
+        piece = piece->next;
+    }
+
+    // The uncovered cell of an any group is covered by a hole, a 1x1 piece kept on the group's cells,
+    // so that the dates leave the group out and every engine handles it as any other piece
+    uint64_t kept[MAX_PIECES] = {0};
+    for (int g = 0; g < def->anys; g++)
+    {
+        shapes *hole = (shapes *)malloc(sizeof(shapes));
+        hole->height = hole->width = 1;
+        hole->next = NULL;
+        hole->mask = (uint8_t *)calloc(1, sizeof(uint8_t));
+        hole->mask[0] = 1;
+        add_shapes(hole, all, def->mirror);
+
+        for (int y = 0; y < def->height; y++)
+            for (int x = 0; x < def->width; x++)
+                if (def->layout[y][x] == def->any_names[g])
+                    kept[def->piece_count + g] |= 1ULL << CELL(x, y);
+    }
+
+    uint64_t cells = 0, blocked = 0;
+    for (int y = 0; y < def->height; y++)
+        for (int x = 0; x < def->width; x++)
+        {
+            cells |= 1ULL << CELL(x, y);
+            if (def->layout[y][x] == '#')
+                blocked |= 1ULL << CELL(x, y);
+        }
+
+    // Count everything first so the tables fit in one block
+    uint32_t variant_count = 0, placement_count = 0, pieces = 0;
+    for (shapes_list *list = all; list != NULL; list = list->next, pieces++)
+        for (shapes *shape = list->shapes; shape != NULL; shape = shape->next)
+        {
+            variant_count++;
+            for (int y = 0; y + shape->height <= def->height; y++)
+                for (int x = 0; x + shape->width <= def->width; x++)
+                {
+                    uint64_t mask = 0;
+                    for (int i = 0; i < shape->height; i++)
+                        mask |= (uint64_t)shape->mask[i] << CELL(x, y + i);
+                    if (placement_fits(mask, blocked, kept[pieces]))
+                        placement_count++;
+                }
+        }
+
+    // Placements are indexed by uint16 everywhere, from the anchored and covering indexes to the
+    // solutions written out
+    if (placement_count > UINT16_MAX)
+    {
+        fprintf(stderr, "Error : the puzzle has %u placements, at most %u are supported\n", placement_count, UINT16_MAX);
+        free_list(all);
+        return NULL;
+    }
+
+    size_t variants_offset = ALIGN(sizeof(tables_header));
+    size_t placements_offset = ALIGN(variants_offset + sizeof(variant_entry) * variant_count);
+    size_t anchored_offset = ALIGN(placements_offset + sizeof(placement) * placement_count);
+    size_t covering_offset = ALIGN(anchored_offset + sizeof(uint16_t) * placement_count);
+    size_t length = ALIGN(covering_offset + sizeof(uint16_t) * placement_count * 64);
+
+    uint8_t *memory = (uint8_t *)calloc(1, length);
+    tables_header *header = (tables_header *)memory;
+    variant_entry *variants = (variant_entry *)(memory + variants_offset);
+    placement *placements = (placement *)(memory + placements_offset);
+    uint16_t *anchored = (uint16_t *)(memory + anchored_offset);
+    uint16_t *covering = (uint16_t *)(memory + covering_offset);
+
+    memcpy(header->magic, TABLES_MAGIC, 4);
+    header->version = TABLES_VERSION;
+    header->height = def->height;
+    header->width = def->width;
+    header->cells = cells;
+    header->blocked = blocked;
+    header->mirror = def->mirror;
+    header->groups = def->groups;
+    header->variants = variant_count;
+    header->placements = placement_count;
+    header->variants_offset = variants_offset;
+    header->placements_offset = placements_offset;
+    header->anchored_offset = anchored_offset;
+    header->covering_offset = covering_offset;
+
+    // Groups, cells in row-major order
+    memcpy(header->group_names, def->group_names, MAX_GROUPS);
+    int n = 0;
+    for (int g = 0; g < def->groups; g++)
+    {
+        header->group_start[g] = n;
+        for (int y = 0; y < def->height; y++)
+            for (int x = 0; x < def->width; x++)
+                if (def->layout[y][x] == def->group_names[g])
+                    header->group_cells[n++] = CELL(x, y);
+    }
+    header->group_start[def->groups] = n;
+
+    // Variants and placements, in the order find_solutions used to try them
+    uint32_t v = 0, p = 0;
+    pieces = 0;
+    for (shapes_list *list = all; list != NULL; list = list->next, pieces++)
+    {
+        header->piece_variants[pieces] = v;
+        header->piece_placements[pieces] = p;
+        header->piece_size[pieces] = count_full_spots(list->shapes);
+        header->piece_cells[pieces] = kept[pieces];
+
+        for (shapes *shape = list->shapes; shape != NULL; shape = shape->next, v++)
+        {
+            variant_entry *variant = variants + v;
+            variant->piece = pieces;
+            variant->height = shape->height;
+            variant->width = shape->width;
+            variant->size = header->piece_size[pieces];
+            memcpy(variant->rows, shape->mask, shape->height);
+
+            for (int y = 0; y + shape->height <= def->height; y++)
+                for (int x = 0; x + shape->width <= def->width; x++)
+                {
+                    uint64_t mask = 0;
+                    for (int i = 0; i < shape->height; i++)
+                        mask |= (uint64_t)shape->mask[i] << CELL(x, y + i);
+                    if (!placement_fits(mask, blocked, kept[pieces]))
+                        continue;
+
+                    placements[p].mask = mask;
+                    placements[p].piece = pieces;
+                    placements[p].variant = v;
+                    placements[p].x = x;
+                    placements[p].y = y;
+                    placements[p].cell = __builtin_ctzll(mask);
+                    p++;
+                }
+        }
+    }
+    header->pieces = pieces;
+    header->piece_variants[pieces] = v;
+    header->piece_placements[pieces] = p;
+
+    // The covering index is much shorter than the worst case reserved above
+    uint32_t c = build_indexes(header, placements, anchored, covering);
+    length = ALIGN(covering_offset + sizeof(uint16_t) * c);
+    header->file_size = length;
+
+    free_list(all);
+
+    puzzle_tables *tables = (puzzle_tables *)malloc(sizeof(puzzle_tables));
+    tables->header = header;
+    tables->variants = variants;
+    tables->placements = placements;
+    tables->anchored = anchored;
+    tables->covering = covering;
+    tables->memory = memory;
+    tables->length = length;
+    tables->storage = TABLES_ALLOCATED;
+
+    header->hash = hash_tables(tables);
+
+    return tables;
+}
+
+//-------------------------Reordering-------------------------
+
+puzzle_tables *tables_reorder(const puzzle_tables *tables, const uint8_t *piece_order, const uint16_t *variant_order)
+{
+    const tables_header *old = tables->header;
+
+    // Same sizes as the original, only the order changes. Generated tables have no offsets, the
+    // layout is the one of a parsed definition
+    size_t variants_offset = ALIGN(sizeof(tables_header));
+    size_t placements_offset = ALIGN(variants_offset + sizeof(variant_entry) * old->variants);
+    size_t anchored_offset = ALIGN(placements_offset + sizeof(placement) * old->placements);
+    size_t covering_offset = ALIGN(anchored_offset + sizeof(uint16_t) * old->placements);
+    size_t length = ALIGN(covering_offset + sizeof(uint16_t) * old->covering_start[64]);
+
+    uint8_t *memory = (uint8_t *)calloc(1, length);
+    memcpy(memory, old, sizeof(tables_header));
+    tables_header *header = (tables_header *)memory;
+    header->file_size = length;
+    header->variants_offset = variants_offset;
+    header->placements_offset = placements_offset;
+    header->anchored_offset = anchored_offset;
+    header->covering_offset = covering_offset;
+    variant_entry *variants = (variant_entry *)(memory + header->variants_offset);
+    placement *placements = (placement *)(memory + header->placements_offset);
+    uint16_t *anchored = (uint16_t *)(memory + header->anchored_offset);
+    uint16_t *covering = (uint16_t *)(memory + header->covering_offset);
+
+    // Placements are grouped by variant
+    uint32_t variant_start[old->variants + 1];
+    memset(variant_start, 0, sizeof(variant_start));
+    for (uint32_t p = 0; p < old->placements; p++)
+        variant_start[tables->placements[p].variant + 1]++;
+    for (uint32_t v = 0; v < old->variants; v++)
+        variant_start[v + 1] += variant_start[v];
+
+    uint32_t v = 0, p = 0;
+    for (uint32_t piece = 0; piece < old->pieces; piece++)
+    {
+        uint32_t from = piece_order[piece];
+        header->piece_variants[piece] = v;
+        header->piece_placements[piece] = p;
+        header->piece_size[piece] = old->piece_size[from];
+        header->piece_cells[piece] = old->piece_cells[from];
+
+        for (uint32_t i = 0; i < old->piece_variants[from + 1] - old->piece_variants[from]; i++, v++)
+        {
+            uint32_t old_variant = variant_order[v];
+            variants[v] = tables->variants[old_variant];
+            variants[v].piece = piece;
+
+            for (uint32_t q = variant_start[old_variant]; q < variant_start[old_variant + 1]; q++, p++)
+            {
+                placements[p] = tables->placements[q];
+                placements[p].piece = piece;
+                placements[p].variant = v;
+            }
+        }
+    }
+    header->piece_variants[old->pieces] = v;
+    header->piece_placements[old->pieces] = p;
+    build_indexes(header, placements, anchored, covering);
+
+    puzzle_tables *reordered = (puzzle_tables *)malloc(sizeof(puzzle_tables));
+    reordered->header = header;
+    reordered->variants = variants;
+    reordered->placements = placements;
+    reordered->anchored = anchored;
+    reordered->covering = covering;
+    reordered->memory = memory;
+    reordered->length = length;
+    reordered->storage = TABLES_ALLOCATED;
+
+    // A new order is a new cache, cached solutions refer to pieces and variants by index
+    header->hash = hash_tables(reordered);
+
+    return reordered;
+}
+
+//-------------------------Loading-------------------------
+
+// Whether count items of size bytes at offset lie within the length bytes after the header, aligned
+static bool section_fits(const uint64_t offset, const uint64_t count, const size_t size, const size_t length)
+{
+    return offset >= sizeof(tables_header) && offset % 8 == 0 && offset <= length && count <= (length - offset) / size;
+}
+
+// Ranges are non-decreasing from 0 to their last entry
+static bool ranges_valid(const uint32_t *start, const int count, const uint32_t last)
+{
+    if (start[0] != 0 || start[count] != last)
+        return false;
+    for (int i = 0; i < count; i++)
+        if (start[i] > start[i + 1])
+            return false;
+    return true;
+}
+
+// Everything the programs index with is checked, so that a truncated or corrupt file is refused
+// rather than read out of bounds
+static bool tables_valid(const tables_header *header, const uint8_t *memory, const size_t length)
+{
+    if (header->pieces == 0 || header->pieces > MAX_PIECES || header->groups > MAX_GROUPS || header->height < 1 || header->height > 8 ||
+        header->width < 1 || header->width > 8 || header->placements > UINT16_MAX)
+        return false;
+    if (!section_fits(header->variants_offset, header->variants, sizeof(variant_entry), length) ||
+        !section_fits(header->placements_offset, header->placements, sizeof(placement), length) ||
+        !section_fits(header->anchored_offset, header->anchored_start[64], sizeof(uint16_t), length) ||
+        !section_fits(header->covering_offset, header->covering_start[64], sizeof(uint16_t), length))
+        return false;
+
+    if (!ranges_valid(header->piece_variants, header->pieces, header->variants) || !ranges_valid(header->piece_placements, header->pieces, header->placements) ||
+        !ranges_valid(header->anchored_start, 64, header->placements) || !ranges_valid(header->covering_start, 64, header->covering_start[64]) ||
+        !ranges_valid(header->group_start, header->groups, header->group_start[header->groups]) || header->group_start[header->groups] > 64)
+        return false;
+    for (uint32_t i = 0; i < header->group_start[header->groups]; i++)
+        if (header->group_cells[i] >= 64)
+            return false;
+
+    const variant_entry *variants = (const variant_entry *)(memory + header->variants_offset);
+    for (uint32_t piece = 0; piece < header->pieces; piece++)
+        for (uint32_t v = header->piece_variants[piece]; v < header->piece_variants[piece + 1]; v++)
+            if (variants[v].piece != piece || variants[v].height < 1 || variants[v].height > 8 || variants[v].width < 1 || variants[v].width > 8)
+                return false;
+
+    const placement *placements = (const placement *)(memory + header->placements_offset);
+    for (uint32_t piece = 0; piece < header->pieces; piece++)
+        for (uint32_t p = header->piece_placements[piece]; p < header->piece_placements[piece + 1]; p++)
+            if (placements[p].piece != piece || placements[p].variant < header->piece_variants[piece] || placements[p].variant >= header->piece_variants[piece + 1] ||
+                placements[p].cell >= 64 || placements[p].x >= 8 || placements[p].y >= 8)
+                return false;
+
+    const uint16_t *anchored = (const uint16_t *)(memory + header->anchored_offset);
+    const uint16_t *covering = (const uint16_t *)(memory + header->covering_offset);
+    for (uint32_t i = 0; i < header->anchored_start[64]; i++)
+        if (anchored[i] >= header->placements)
+            return false;
+    for (uint32_t i = 0; i < header->covering_start[64]; i++)
+        if (covering[i] >= header->placements)
+            return false;
+    return true;
+}
+
+static puzzle_tables *wrap_memory(void *memory, size_t length)
+{
+    const tables_header *header = (const tables_header *)memory;
+    if (length < sizeof(tables_header) || memcmp(header->magic, TABLES_MAGIC, 4) != 0 || header->version != TABLES_VERSION || header->file_size != length ||
+        !tables_valid(header, (const uint8_t *)memory, length))
+        return NULL;
+
+    puzzle_tables *tables = (puzzle_tables *)malloc(sizeof(puzzle_tables));
+    tables->header = header;
+    tables->variants = (const variant_entry *)((const uint8_t *)memory + header->variants_offset);
+    tables->placements = (const placement *)((const uint8_t *)memory + header->placements_offset);
+    tables->anchored = (const uint16_t *)((const uint8_t *)memory + header->anchored_offset);
+    tables->covering = (const uint16_t *)((const uint8_t *)memory + header->covering_offset);
+    tables->memory = memory;
+    tables->length = length;
+    tables->storage = TABLES_MAPPED;
+    return tables;
+}
+
+puzzle_tables *tables_map(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Error : cannot open the compiled puzzle %s\n", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        fprintf(stderr, "Error : cannot read the compiled puzzle %s\n", path);
+        return NULL;
+    }
+
+    void *memory = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        fprintf(stderr, "Error : cannot map the compiled puzzle %s\n", path);
+        return NULL;
+    }
+
+    puzzle_tables *tables = wrap_memory(memory, st.st_size);
+    if (tables == NULL)
+    {
+        munmap(memory, st.st_size);
+        fprintf(stderr, "Error : %s isn't a valid compiled puzzle of this version, rebuild it with compile_puzzle\n", path);
+    }
+    return tables;
+}
+
+puzzle_tables *tables_parse(const char *path)
+{
+    definition def;
+    if (!parse_definition(path, &def))
+        return NULL;
+
+    puzzle_tables *tables = build_tables(&def);
+    free_definition(&def);
+    return tables;
+}
+
+puzzle_tables *tables_load(const char *path)
+{
+    size_t length = strlen(path);
+    if (length > 4 && strcmp(path + length - 4, ".bin") == 0)
+        return tables_map(path);
+    return tables_parse(path);
+}
+
+puzzle_tables *tables_default()
+{
+#ifdef BUILTIN_TABLES
+    // The standard puzzle is generated into the program by the Makefile
+    return tables_builtin();
+#endif
+
+    // The compiled form is used unless the definition was edited after it
+    struct stat binary, source;
+    bool has_binary = stat(DEFAULT_BINARY, &binary) == 0;
+    bool has_source = stat(DEFAULT_DEFINITION, &source) == 0;
+
+    if (has_binary && (!has_source || binary.st_mtime >= source.st_mtime))
+    {
+        puzzle_tables *tables = tables_map(DEFAULT_BINARY);
+        if (tables != NULL)
+            return tables;
+    }
+
+    return tables_parse(DEFAULT_DEFINITION);
+}
+
+bool tables_write(const puzzle_tables *tables, const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error : cannot write %s\n", path);
+        return false;
+    }
+
+    bool ok = fwrite(tables->memory, 1, tables->length, fp) == tables->length;
+    ok = fclose(fp) == 0 && ok;
+    if (!ok)
+        fprintf(stderr, "Error : cannot write %s\n", path);
+    return ok;
+}
+
+static void write_array(FILE *fp, const char *type, const char *name, const uint32_t *values, uint32_t count)
+{
+    fprintf(fp, "static const %s %s[] = {", type, name);
+    for (uint32_t i = 0; i < count; i++)
+        fprintf(fp, "%s%u", i % 16 ? ", " : (i ? ",\n    " : "\n    "), values[i]);
+    fprintf(fp, "};\n\n");
+}
+
+static void write_field(FILE *fp, const char *name, const uint32_t *values, uint32_t count)
+{
+    fprintf(fp, "    .%s = {", name);
+    for (uint32_t i = 0; i < count; i++)
+        fprintf(fp, "%s%u", i ? ", " : "", values[i]);
+    fprintf(fp, "},\n");
+}
+
+bool tables_write_source(const puzzle_tables *tables, const char *path)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error : cannot write %s\n", path);
+        return false;
+    }
+
+    const tables_header *header = tables->header;
+    // Scratch space for the arrays of smaller types, the covering index is the longest
+    uint32_t *values = (uint32_t *)malloc(sizeof(uint32_t) * (header->covering_start[64] + 64));
+
+    fprintf(fp, "// Generated by compile_puzzle, do not edit\n\n");
+
+    // Header, the offsets only make sense in the binary form
+    fprintf(fp, "static const tables_header standard_header = {\n");
+    fprintf(fp, "    .magic = TABLES_MAGIC,\n    .version = TABLES_VERSION,\n");
+    fprintf(fp, "    .hash = 0x%016llxULL,\n", (unsigned long long)header->hash);
+    fprintf(fp, "    .height = %u,\n    .width = %u,\n", header->height, header->width);
+    fprintf(fp, "    .cells = 0x%016llxULL,\n", (unsigned long long)header->cells);
+    fprintf(fp, "    .blocked = 0x%016llxULL,\n", (unsigned long long)header->blocked);
+    fprintf(fp, "    .mirror = %u,\n", header->mirror);
+    fprintf(fp, "    .groups = %u,\n    .pieces = %u,\n    .variants = %u,\n    .placements = %u,\n", header->groups, header->pieces, header->variants, header->placements);
+
+    fprintf(fp, "    .group_names = {");
+    for (uint32_t g = 0; g < header->groups; g++)
+        fprintf(fp, "%s'%c'", g ? ", " : "", header->group_names[g]);
+    fprintf(fp, "},\n");
+    write_field(fp, "group_start", header->group_start, header->groups + 1);
+    for (uint32_t i = 0; i < header->group_start[header->groups]; i++)
+        values[i] = header->group_cells[i];
+    write_field(fp, "group_cells", values, header->group_start[header->groups]);
+
+    write_field(fp, "piece_variants", header->piece_variants, header->pieces + 1);
+    write_field(fp, "piece_placements", header->piece_placements, header->pieces + 1);
+    write_field(fp, "piece_size", header->piece_size, header->pieces);
+    for (uint32_t i = 0; i < header->pieces; i++)
+        if (header->piece_cells[i] != 0)
+            fprintf(fp, "    .piece_cells[%u] = 0x%016llxULL,\n", i, (unsigned long long)header->piece_cells[i]);
+    write_field(fp, "anchored_start", header->anchored_start, 65);
+    write_field(fp, "covering_start", header->covering_start, 65);
+    fprintf(fp, "};\n\n");
+
+    // Variants, then placements in search order
+    fprintf(fp, "static const variant_entry standard_variants[] = {\n");
+    for (uint32_t i = 0; i < header->variants; i++)
+    {
+        const variant_entry *variant = tables->variants + i;
+        fprintf(fp, "    {%u, %u, %u, %u, {", variant->piece, variant->height, variant->width, variant->size);
+        for (int r = 0; r < variant->height; r++)
+            fprintf(fp, "%s0x%02x", r ? ", " : "", variant->rows[r]);
+        fprintf(fp, "}},\n");
+    }
+    fprintf(fp, "};\n\n");
+
+    fprintf(fp, "static const placement standard_placements[] = {\n");
+    for (uint32_t i = 0; i < header->placements; i++)
+    {
+        const placement *p = tables->placements + i;
+        fprintf(fp, "    {0x%016llxULL, %u, %u, %u, %u, %u, 0},\n", (unsigned long long)p->mask, p->piece, p->variant, p->x, p->y, p->cell);
+    }
+    fprintf(fp, "};\n\n");
+
+    // Per cell indexes
+    for (uint32_t i = 0; i < header->anchored_start[64]; i++)
+        values[i] = tables->anchored[i];
+    write_array(fp, "uint16_t", "standard_anchored", values, header->anchored_start[64]);
+
+    for (uint32_t i = 0; i < header->covering_start[64]; i++)
+        values[i] = tables->covering[i];
+    write_array(fp, "uint16_t", "standard_covering", values, header->covering_start[64]);
+    free(values);
+
+    bool ok = fclose(fp) == 0;
+    if (!ok)
+        fprintf(stderr, "Error : cannot write %s\n", path);
+    return ok;
+}
+
+void tables_free(puzzle_tables *tables)
+{
+    if (tables == NULL || tables->storage == TABLES_STATIC)
+        return;
+
+    if (tables->storage == TABLES_MAPPED)
+        munmap(tables->memory, tables->length);
+    else
+        free(tables->memory);
+    free(tables);
+}
+
+//-------------------------Boards-------------------------
+
+int tables_group_size(const puzzle_tables *tables, const int group)
+{
+    const tables_header *header = tables->header;
+    if (group < 0 || group >= (int)header->groups)
+        return 0;
+    return header->group_start[group + 1] - header->group_start[group];
+}
+
+int tables_date_range(const puzzle_tables *tables, const int field)
+{
+    return field < (int)tables->header->groups ? tables_group_size(tables, field) : 1;
+}
+
+bool tables_check_dates(const puzzle_tables *tables)
+{
+    if (tables->header->groups > DATE_FIELDS)
+    {
+        fprintf(stderr, "Error : the puzzle has %u target groups, dates have %d fields\n", tables->header->groups, DATE_FIELDS);
+        return false;
+    }
+    return true;
+}
+
+bool tables_date_board(const puzzle_tables *tables, const int *targets, uint64_t *board)
+{
+    const tables_header *header = tables->header;
+
+    // Cells outside of the board count as covered
+    *board = header->blocked | ~header->cells;
+    if (header->groups > DATE_FIELDS)
+        return false;
+
+    for (int g = 0; g < DATE_FIELDS; g++)
+    {
+        if (targets[g] < 0 || targets[g] >= tables_date_range(tables, g))
+            return false;
+        if (g < (int)header->groups)
+            *board |= 1ULL << header->group_cells[header->group_start[g] + targets[g]];
+    }
+
+    return true;
+}
+
+int tables_free_cells(const puzzle_tables *tables, const uint64_t board)
+{
+    return __builtin_popcountll(tables->header->cells & ~board);
+}
+
+int tables_pieces_area(const puzzle_tables *tables)
+{
+    int area = 0;
+    for (uint32_t i = 0; i < tables->header->pieces; i++)
+        area += tables->header->piece_size[i];
+    return area;
+}
+
+//-------------------------Placements-------------------------
+
+int tables_find_placement(const puzzle_tables *tables, const int piece, const int variant, const int x, const int y)
+{
+    const tables_header *header = tables->header;
+    if (piece < 0 || piece >= (int)header->pieces || variant < 0 || variant >= (int)(header->piece_variants[piece + 1] - header->piece_variants[piece]))
+        return -1;
+
+    for (uint32_t p = header->piece_placements[piece]; p < header->piece_placements[piece + 1]; p++)
+    {
+        const placement *candidate = tables->placements + p;
+        if (candidate->variant == header->piece_variants[piece] + variant && candidate->x == x && candidate->y == y)
+            return p;
+    }
+    return -1;
+}
+
+bool tables_parse_placements(const puzzle_tables *tables, const char *list, uint16_t *placements, int *count)
+{
+    *count = 0;
+    const char *c = list;
+    while (*c != '\0')
+    {
+        int piece, variant, x, y, n;
+        if (sscanf(c, "%d:%d:%d:%d%n", &piece, &variant, &x, &y, &n) != 4)
+        {
+            fprintf(stderr, "Error : %s isn't a piece:variant:x:y list\n", list);
+            return false;
+        }
+
+        int p = tables_find_placement(tables, piece, variant, x, y);
+        if (p < 0)
+        {
+            fprintf(stderr, "Error : piece %d has no variant %d fitting at %d %d\n", piece, variant, x, y);
+            return false;
+        }
+        if (*count == MAX_PIECES)
+        {
+            fprintf(stderr, "Error : more placements than pieces in %s\n", list);
+            return false;
+        }
+        placements[(*count)++] = p;
+
+        c += n;
+        if (*c == ',')
+            c++;
+        else if (*c != '\0')
+        {
+            fprintf(stderr, "Error : %s isn't a piece:variant:x:y list\n", list);
+            return false;
+        }
+    }
+    return true;
+}
+
+//-------------------------Debugging-------------------------
+
+void print_variant(const variant_entry *variant)
+{
+    for (int i = 0; i < variant->height; i++)
+    {
+        for (int j = 0; j < variant->width; j++)
+        {
+            if (variant->rows[i] & (1U << j))
+                printf("1 ");
+            else
+                printf(". ");
+        }
+        printf("\n");
+    }
+}
+
+void print_bitboard(const puzzle_tables *tables, const uint64_t board)
+{
+    for (uint32_t y = 0; y < tables->header->height; y++)
+    {
+        for (uint32_t x = 0; x < tables->header->width; x++)
+        {
+            if (board & (1ULL << CELL(x, y)))
+                printf("1 ");
+            else
+                printf(". ");
+        }
+        printf("\n");
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef TABLES_H
+#define TABLES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "puzzle.h"
+
+// A board is a 64 bit mask, cell (x, y) is bit y * 8 + x and a set bit is a covered cell
+#define CELL(x, y) ((y) * 8 + (x))
+
+#define MAX_PIECES 16
+#define MAX_GROUPS 8
+
+// Programs take dates as DATE_FIELDS targets (month, month day, week day), the fields past the
+// puzzle's target groups are 0
+#define DATE_FIELDS 3
+
+#define TABLES_MAGIC "PZB1"
+#define TABLES_VERSION 2
+
+#define DEFAULT_DEFINITION "puzzle.def"
+#define DEFAULT_BINARY "puzzle.bin"
+
+typedef struct variant_entry
+{
+    uint8_t piece, height, width, size;
+    uint8_t rows[8];
+} variant_entry;
+
+typedef struct placement
+{
+    uint64_t mask;
+    uint16_t piece, variant;
+    uint8_t x, y, cell, padding; // cell is the lowest covered cell
+} placement;
+
+// Header of the binary form, the arrays follow it at the given offsets
+typedef struct tables_header
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t hash;
+    uint64_t file_size;
+
+    uint32_t height, width;
+    uint64_t cells;   // Cells inside the board geometry
+    uint64_t blocked; // Cells which are never covered
+
+    uint32_t mirror;
+    uint32_t groups, pieces, variants, placements;
+
+    // Target groups, one cell of each group is left uncovered
+    char group_names[MAX_GROUPS];
+    uint32_t group_start[MAX_GROUPS + 1];
+    uint8_t group_cells[64];
+
+    // Per piece ranges into the variants and placements arrays
+    uint32_t piece_variants[MAX_PIECES + 1];
+    uint32_t piece_placements[MAX_PIECES + 1];
+    uint32_t piece_size[MAX_PIECES];
+    uint64_t piece_cells[MAX_PIECES]; // Cells a piece is kept on, 0 for anywhere
+
+
+    // Per cell ranges into the anchored (lowest cell) and covering placement indexes
+    uint32_t anchored_start[65];
+    uint32_t covering_start[65];
+
+    uint64_t variants_offset, placements_offset, anchored_offset, covering_offset;
+} tables_header;
+
+typedef enum tables_storage
+{
+    TABLES_ALLOCATED,
+    TABLES_MAPPED,
+    TABLES_STATIC // Generated into the program, see builtin_tables.c
+} tables_storage;
+
+typedef struct puzzle_tables
+{
+    const tables_header *header;
+    const variant_entry *variants;
+    const placement *placements;
+    const uint16_t *anchored;
+    const uint16_t *covering;
+
+    void *memory;
+    size_t length;
+    tables_storage storage;
+} puzzle_tables;
+
+// Hashing
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t length);
+
+// Loading, tables_load maps a compiled file or builds the tables from a definition
+puzzle_tables *tables_load(const char *path);
+puzzle_tables *tables_map(const char *path);
+puzzle_tables *tables_parse(const char *path);
+puzzle_tables *tables_default();
+bool tables_write(const puzzle_tables *tables, const char *path);
+bool tables_write_source(const puzzle_tables *tables, const char *path);
+#ifdef BUILTIN_TABLES
+puzzle_tables *tables_builtin();
+#endif
+void tables_free(puzzle_tables *tables);
+
+// Copy of the tables with the pieces in piece_order (old index of each new piece) and the variants
+// in variant_order (old index of each new variant, grouped by new piece). The copy has its own hash.
+puzzle_tables *tables_reorder(const puzzle_tables *tables, const uint8_t *piece_order, const uint16_t *variant_order);
+
+// Boards
+int tables_group_size(const puzzle_tables *tables, const int group);
+// Values of a date field, the size of its group or 1 past the puzzle's groups
+int tables_date_range(const puzzle_tables *tables, const int field);
+// Whether the puzzle's targets fit in dates, prints why not
+bool tables_check_dates(const puzzle_tables *tables);
+// Board of a date of DATE_FIELDS targets, false if one is out of its range
+bool tables_date_board(const puzzle_tables *tables, const int *targets, uint64_t *board);
+int tables_free_cells(const puzzle_tables *tables, const uint64_t board);
+int tables_pieces_area(const puzzle_tables *tables);
+
+// Placements, variants counted from the piece's first one. Index of a placement, -1 if the piece
+// can't be put there.
+int tables_find_placement(const puzzle_tables *tables, const int piece, const int variant, const int x, const int y);
+
+// Parses a "piece:variant:x:y" list separated by commas, at most MAX_PIECES placements
+bool tables_parse_placements(const puzzle_tables *tables, const char *list, uint16_t *placements, int *count);
+
+// Debugging
+void print_variant(const variant_entry *variant);
+void print_bitboard(const puzzle_tables *tables, const uint64_t board);
+
+#endif
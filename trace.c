@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "trace.h"
+
+#define TRACE_CHUNK 4096
+#define TRACE_REMOTE_LANES 1000
+
+typedef struct trace_event
+{
+    const char *name;
+    int lane;
+    bool remote; // The lane was given by the caller
+    double start, end;
+    trace_task task;
+} trace_event;
+
+// Events of one thread, only this thread appends to it
+typedef struct trace_buffer
+{
+    trace_event *events;
+    int count, capacity;
+    int lane;
+    struct trace_buffer *next;
+} trace_buffer;
+
+static FILE *trace_file = NULL;
+static struct timespec trace_start;
+static _Atomic(trace_buffer *) trace_buffers = NULL;
+static atomic_int trace_lanes = 0;
+static _Thread_local trace_buffer *local_buffer = NULL;
+
+//-------------------------Recording-------------------------
+
+bool trace_open(const char *path)
+{
+    trace_file = fopen(path, "w");
+    if (trace_file == NULL)
+    {
+        fprintf(stderr, "Error : cannot create %s\n", path);
+        return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &trace_start);
+    return true;
+}
+
+bool trace_enabled()
+{
+    return trace_file != NULL;
+}
+
+double trace_clock()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - trace_start.tv_sec) * 1e6 + (now.tv_nsec - trace_start.tv_nsec) * 1e-3;
+}
+
+static trace_buffer *thread_buffer()
+{
+    if (local_buffer != NULL)
+        return local_buffer;
+
+    // A thread's first event pushes its buffer on the list, lanes count from 1 in that order
+    trace_buffer *buffer = (trace_buffer *)calloc(1, sizeof(trace_buffer));
+    buffer->lane = atomic_fetch_add(&trace_lanes, 1) + 1;
+    buffer->next = atomic_load(&trace_buffers);
+    while (!atomic_compare_exchange_weak(&trace_buffers, &buffer->next, buffer))
+        ;
+    local_buffer = buffer;
+    return buffer;
+}
+
+void trace_record(const char *name, const int lane, const double start, const trace_task *task)
+{
+    if (trace_file == NULL)
+        return;
+
+    trace_buffer *buffer = thread_buffer();
+    if (buffer->count == buffer->capacity)
+    {
+        buffer->capacity += TRACE_CHUNK;
+        buffer->events = (trace_event *)realloc(buffer->events, sizeof(trace_event) * buffer->capacity);
+    }
+
+    trace_event *event = buffer->events + buffer->count++;
+    event->name = name;
+    event->lane = lane >= 0 ? lane : buffer->lane;
+    event->remote = lane >= 0;
+    event->start = start;
+    event->end = trace_clock();
+    event->task = *task;
+}
+
+//-------------------------Output-------------------------
+
+void trace_close()
+{
+    if (trace_file == NULL)
+        return;
+
+    int remote_lanes = 0;
+    for (trace_buffer *buffer = atomic_load(&trace_buffers); buffer != NULL; buffer = buffer->next)
+        for (int i = 0; i < buffer->count; i++)
+            if (buffer->events[i].remote && buffer->events[i].lane >= remote_lanes)
+                remote_lanes = buffer->events[i].lane + 1;
+    bool *named = (bool *)calloc(remote_lanes + 1, sizeof(bool));
+
+    // Complete events, one lane (tid) per thread or remote worker, named by metadata events. Remote
+    // lanes come after the threads' ones.
+    fprintf(trace_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (trace_buffer *buffer = atomic_load(&trace_buffers); buffer != NULL; buffer = buffer->next)
+    {
+        bool thread_named = false;
+        for (int i = 0; i < buffer->count; i++)
+        {
+            const trace_event *event = buffer->events + i;
+            int tid = event->remote ? TRACE_REMOTE_LANES + event->lane : event->lane;
+            if (event->remote ? !named[event->lane] : !thread_named)
+            {
+                fprintf(trace_file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}", first ? "" : ",\n", tid,
+                        event->remote ? "worker" : "thread", event->lane);
+                if (event->remote)
+                    named[event->lane] = true;
+                else
+                    thread_named = true;
+                first = false;
+            }
+
+            const trace_task *task = &event->task;
+            fprintf(trace_file,
+                    "%s{\"name\":\"%s\",\"cat\":\"sweep\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"args\":{\"month\":%d,\"day\":%d,\"week_day\":%d,\"unit\":%d,\"depth\":%d,\"solutions\":%llu,\"nodes\":%llu}}",
+                    first ? "" : ",\n", event->name, tid, event->start, event->end - event->start, task->date[0], task->date[1], task->date[2], task->unit,
+                    task->depth, (unsigned long long)task->solutions, (unsigned long long)task->nodes);
+            first = false;
+        }
+    }
+    fprintf(trace_file, "\n]}\n");
+    free(named);
+    fclose(trace_file);
+    trace_file = NULL;
+
+    trace_buffer *buffer = atomic_exchange(&trace_buffers, NULL);
+    while (buffer != NULL)
+    {
+        trace_buffer *next = buffer->next;
+        free(buffer->events);
+        free(buffer);
+        buffer = next;
+    }
+    local_buffer = NULL;
+}
@@ -0,0 +1,33 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// What a traced task worked on
+typedef struct trace_task
+{
+    int date[3];
+    int unit;  // Work unit index, -1 for a whole date
+    int depth; // Pieces placed by the unit's prefix
+    uint64_t solutions, nodes;
+} trace_task;
+
+// Starts recording tasks, trace_close writes them to path as Chrome trace events (chrome://tracing
+// or ui.perfetto.dev). Returns false if path can't be created.
+bool trace_open(const char *path);
+
+// Whether trace_open was called, tasks are only timed and recorded then
+bool trace_enabled();
+
+// Microseconds since trace_open
+double trace_clock();
+
+// Records a task which ran from start until now. Every thread appends to its own buffer without
+// locking and has its own lane in the timeline, unless lane is given (>= 0, e.g. a remote worker).
+void trace_record(const char *name, const int lane, const double start, const trace_task *task);
+
+// Writes the trace and frees the buffers, once every recording thread has stopped
+void trace_close();
+
+#endif
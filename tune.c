@@ -0,0 +1,329 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "tables.h"
+#include "engine.h"
+#include "profile.h"
+
+typedef struct tune_dates
+{
+    uint64_t boards[64];
+    uint64_t seeds[64];
+    int count;
+} tune_dates;
+
+// Command line
+void usage();
+
+// Dates
+void sample_dates(const puzzle_tables *tables, const int wanted, tune_dates *dates);
+
+// Costs
+static uint64_t next_random(uint64_t *seed);
+double estimate_work(const puzzle_tables *tables, const uint64_t board, const int samples, uint64_t *seed);
+double order_cost(const puzzle_tables *tables, const order_profile *profile, const tune_dates *dates, const int samples);
+uint64_t first_solution_nodes(const puzzle_tables *tables, const order_profile *profile, const tune_dates *dates);
+
+// Tuning
+double tune_pieces(const puzzle_tables *tables, order_profile *best, const tune_dates *dates, const int samples, const int iterations);
+void tune_variants(const puzzle_tables *tables, order_profile *best, const tune_dates *dates);
+
+void usage()
+{
+    fprintf(stderr, "Usage: ./tune [-p puzzle] [-d dates] [-s samples] [-i iterations] [-o profile]\n"
+                    "  -d  dates sampled from the year (default 16, at most 64)\n"
+                    "  -s  random descents per date and order (default 1024)\n"
+                    "  -i  piece swaps tried after the first orders (default 200)\n"
+                    "  -o  profile file to write (default " PROFILE_FILE ")\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *puzzle_path = NULL;
+    const char *output = PROFILE_FILE;
+    int wanted = 16, samples = 1024, iterations = 200;
+
+    int option;
+    while ((option = getopt(argc, argv, "p:d:s:i:o:")) != -1)
+    {
+        switch (option)
+        {
+        case 'p':
+            puzzle_path = optarg;
+            break;
+        case 'd':
+            wanted = atoi(optarg);
+            break;
+        case 's':
+            samples = atoi(optarg);
+            break;
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (wanted < 1 || wanted > 64 || samples < 1 || iterations < 0)
+        usage();
+
+    // Tuning always starts from the definition order, whatever the current profile
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    if (!tables_check_dates(tables))
+        exit(1);
+
+    tune_dates dates;
+    sample_dates(tables, wanted, &dates);
+    if (dates.count == 0)
+    {
+        fprintf(stderr, "Error : no date of this puzzle has a solution\n");
+        exit(1);
+    }
+    printf("Tuning on %d dates\n", dates.count);
+
+    order_profile best;
+    profile_identity(tables, &best);
+    double start_cost = order_cost(tables, &best, &dates, samples);
+    uint64_t start_nodes = first_solution_nodes(tables, &best, &dates);
+    printf("Definition order : %.3g estimated placement tests per date, %llu nodes to the first solutions\n", start_cost / dates.count, (unsigned long long)start_nodes);
+
+    double cost = tune_pieces(tables, &best, &dates, samples, iterations);
+    tune_variants(tables, &best, &dates);
+
+    uint64_t nodes = first_solution_nodes(tables, &best, &dates);
+    printf("Tuned order      : %.3g estimated placement tests per date, %llu nodes to the first solutions\n", cost / dates.count, (unsigned long long)nodes);
+
+    char comment[256];
+    snprintf(comment, sizeof(comment), "Tuned on %d dates : %.3g estimated placement tests per date (%.3g in definition order)", dates.count, cost / dates.count, start_cost / dates.count);
+    int status = profile_write(output, &best, comment) ? 0 : 1;
+    if (status == 0)
+        printf("Profile written to %s\n", output);
+
+    tables_free(tables);
+    return status;
+}
+
+//-------------------------Dates-------------------------
+
+void sample_dates(const puzzle_tables *tables, const int wanted, tune_dates *dates)
+{
+    int sizes[3] = {tables_date_range(tables, 0), tables_date_range(tables, 1), tables_date_range(tables, 2)};
+    int total = sizes[0] * sizes[1] * sizes[2];
+
+    search_options options;
+    search_options_init(&options);
+    options.order = ORDER_CELL;
+    options.limit = 1;
+
+    // Evenly spread over the year, dates without solutions would only be measured by full searches
+    dates->count = 0;
+    for (int i = 0; i < wanted && i < total; i++)
+    {
+        int index = (int)((long)i * total / wanted);
+        int date[3] = {index / (sizes[1] * sizes[2]), index / sizes[2] % sizes[1], index % sizes[2]};
+        uint64_t board;
+        tables_date_board(tables, date, &board);
+        if (tables_free_cells(tables, board) != tables_pieces_area(tables) || engine_search(tables, board, &options).solutions == 0)
+            continue;
+
+        dates->boards[dates->count] = board;
+        dates->seeds[dates->count] = (board ^ 0x9E3779B97F4A7C15ULL) | 1;
+        dates->count++;
+    }
+}
+
+//-------------------------Costs-------------------------
+
+static uint64_t next_random(uint64_t *seed)
+{
+    // xorshift64*, the seed must not be 0
+    *seed ^= *seed >> 12;
+    *seed ^= *seed << 25;
+    *seed ^= *seed >> 27;
+    return *seed * 0x2545F4914F6CDD1DULL;
+}
+
+double estimate_work(const puzzle_tables *tables, const uint64_t board, const int samples, uint64_t *seed)
+{
+    const tables_header *header = tables->header;
+    const placement *placements = tables->placements;
+    double total = 0;
+
+    // Knuth's estimator of the fixed order search's work : a node of depth i tests every placement
+    // of piece i, so it weighs that piece's placements count rather than 1
+    for (int s = 0; s < samples; s++)
+    {
+        uint64_t current = board;
+        double width = 1, work = 0;
+        for (uint32_t i = 0; i < header->pieces; i++)
+        {
+            uint32_t start = header->piece_placements[i], end = header->piece_placements[i + 1];
+            work += width * (end - start);
+
+            uint32_t fitting = 0, chosen = 0;
+            for (uint32_t p = start; p < end; p++)
+            {
+                if (current & placements[p].mask)
+                    continue;
+                fitting++;
+                if (next_random(seed) % fitting == 0)
+                    chosen = p;
+            }
+            if (fitting == 0)
+                break;
+
+            width *= fitting;
+            current |= placements[chosen].mask;
+        }
+        total += work;
+    }
+
+    return total / samples;
+}
+
+double order_cost(const puzzle_tables *tables, const order_profile *profile, const tune_dates *dates, const int samples)
+{
+    puzzle_tables *ordered = profile_tables(tables, profile);
+
+    // Every order sees the same random numbers, so that differences come from the order
+    double cost = 0;
+    for (int i = 0; i < dates->count; i++)
+    {
+        uint64_t seed = dates->seeds[i];
+        cost += estimate_work(ordered, dates->boards[i], samples, &seed);
+    }
+
+    tables_free(ordered);
+    return cost;
+}
+
+uint64_t first_solution_nodes(const puzzle_tables *tables, const order_profile *profile, const tune_dates *dates)
+{
+    puzzle_tables *ordered = profile_tables(tables, profile);
+
+    search_options options;
+    search_options_init(&options);
+    options.limit = 1;
+
+    uint64_t nodes = 0;
+    for (int i = 0; i < dates->count; i++)
+        nodes += engine_search(ordered, dates->boards[i], &options).nodes;
+
+    tables_free(ordered);
+    return nodes;
+}
+
+//-------------------------Tuning-------------------------
+
+static int compare_fitting(const void *a, const void *b)
+{
+    double x = ((const double *)a)[0], y = ((const double *)b)[0];
+    return (x > y) - (x < y);
+}
+
+double tune_pieces(const puzzle_tables *tables, order_profile *best, const tune_dates *dates, const int samples, const int iterations)
+{
+    const tables_header *header = tables->header;
+    uint32_t n = header->pieces;
+    double best_cost = order_cost(tables, best, dates, samples);
+
+    // First candidates : pieces with the fewest fitting placements first, then the most
+    double fitting[MAX_PIECES][2];
+    for (uint32_t piece = 0; piece < n; piece++)
+    {
+        fitting[piece][0] = 0;
+        fitting[piece][1] = piece;
+        for (int i = 0; i < dates->count; i++)
+            for (uint32_t p = header->piece_placements[piece]; p < header->piece_placements[piece + 1]; p++)
+                if (!(dates->boards[i] & tables->placements[p].mask))
+                    fitting[piece][0]++;
+    }
+    qsort(fitting, n, sizeof(fitting[0]), compare_fitting);
+
+    for (int reverse = 0; reverse < 2; reverse++)
+    {
+        order_profile candidate;
+        profile_identity(tables, &candidate);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            uint32_t piece = (uint32_t)fitting[reverse ? n - 1 - i : i][1];
+            candidate.piece_order[i] = piece;
+            candidate.variant_count[i] = header->piece_variants[piece + 1] - header->piece_variants[piece];
+            for (int v = 0; v < candidate.variant_count[i]; v++)
+                candidate.variant_order[i][v] = v;
+        }
+
+        double cost = order_cost(tables, &candidate, dates, samples);
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            *best = candidate;
+        }
+    }
+
+    // Then swaps of two pieces, kept when the estimate goes down
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    for (int it = 0; it < iterations && n > 1; it++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        uint32_t i = seed % n, j = (seed >> 32) % n;
+        if (i == j)
+            continue;
+
+        order_profile candidate = *best;
+        uint8_t piece = candidate.piece_order[i];
+        candidate.piece_order[i] = candidate.piece_order[j];
+        candidate.piece_order[j] = piece;
+        uint8_t count = candidate.variant_count[i];
+        candidate.variant_count[i] = candidate.variant_count[j];
+        candidate.variant_count[j] = count;
+        uint8_t variants[MAX_PIECE_VARIANTS];
+        memcpy(variants, candidate.variant_order[i], MAX_PIECE_VARIANTS);
+        memcpy(candidate.variant_order[i], candidate.variant_order[j], MAX_PIECE_VARIANTS);
+        memcpy(candidate.variant_order[j], variants, MAX_PIECE_VARIANTS);
+
+        double cost = order_cost(tables, &candidate, dates, samples);
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            *best = candidate;
+            printf("Swap %d : %.3g estimated placement tests per date\n", it, cost / dates->count);
+        }
+    }
+
+    return best_cost;
+}
+
+void tune_variants(const puzzle_tables *tables, order_profile *best, const tune_dates *dates)
+{
+    // Variant orders don't change the size of a full search, only how soon solutions come : each
+    // piece tries first the variant which reaches the first solutions in the fewest nodes
+    uint64_t best_nodes = first_solution_nodes(tables, best, dates);
+    for (uint32_t i = 0; i < best->pieces; i++)
+        for (int v = 1; v < best->variant_count[i]; v++)
+        {
+            order_profile candidate = *best;
+            uint8_t first = candidate.variant_order[i][v];
+            memmove(candidate.variant_order[i] + 1, candidate.variant_order[i], v);
+            candidate.variant_order[i][0] = first;
+
+            uint64_t nodes = first_solution_nodes(tables, &candidate, dates);
+            if (nodes < best_nodes)
+            {
+                best_nodes = nodes;
+                *best = candidate;
+            }
+        }
+}
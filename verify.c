@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "verify.h"
+
+static int compare_entries(const void *a, const void *b)
+{
+    uint64_t first = ((const verify_entry *)a)->mask, second = ((const verify_entry *)b)->mask;
+    return first < second ? -1 : first > second;
+}
+
+bool verify_init(solution_verifier *verifier, const puzzle_tables *tables, const uint64_t board)
+{
+    const tables_header *header = tables->header;
+
+    memset(verifier, 0, sizeof(solution_verifier));
+    verifier->tables = tables;
+    verifier->board = board;
+    verifier->all_pieces = (1u << header->pieces) - 1;
+    verifier->sorted = (verify_entry *)malloc(sizeof(verify_entry) * header->placements);
+    verifier->seen_capacity = 1024;
+    verifier->seen = (uint16_t *)malloc(sizeof(uint16_t) * header->pieces * verifier->seen_capacity);
+    verifier->slots = (uint32_t *)calloc(2 * verifier->seen_capacity, sizeof(uint32_t));
+    verifier->size_mask = 2 * verifier->seen_capacity - 1;
+    if (verifier->sorted == NULL || verifier->seen == NULL || verifier->slots == NULL)
+    {
+        fprintf(stderr, "Error : cannot allocate the verifier\n");
+        verify_free(verifier);
+        return false;
+    }
+
+    // Placements are grouped by piece, each group is sorted by mask
+    for (uint32_t p = 0; p < header->placements; p++)
+    {
+        verifier->sorted[p].mask = tables->placements[p].mask;
+        verifier->sorted[p].placement = p;
+    }
+    for (uint32_t piece = 0; piece < header->pieces; piece++)
+        qsort(verifier->sorted + header->piece_placements[piece], header->piece_placements[piece + 1] - header->piece_placements[piece],
+              sizeof(verify_entry), compare_entries);
+    return true;
+}
+
+void verify_free(solution_verifier *verifier)
+{
+    free(verifier->sorted);
+    free(verifier->seen);
+    free(verifier->slots);
+    verifier->sorted = NULL;
+    verifier->seen = NULL;
+    verifier->slots = NULL;
+}
+
+const char *verify_status_name(const verify_status status)
+{
+    static const char *names[] = {"valid", "unknown placement or malformed grid", "not a variant", "pieces not used once", "overlap",
+                                  "date cell covered", "free cell uncovered", "duplicate"};
+    return status < VERIFY_STATUSES ? names[status] : "?";
+}
+
+//-------------------------Duplicates-------------------------
+
+static uint64_t solution_hash(const uint16_t *by_piece, const uint32_t pieces)
+{
+    // FNV-1a over the placements, then the splitmix64 finalizer
+    uint64_t key = 0xCBF29CE484222325ULL;
+    for (uint32_t i = 0; i < pieces; i++)
+        key = (key ^ by_piece[i]) * 0x100000001B3ULL;
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ULL;
+    key ^= key >> 27;
+    return key ^ (key >> 31);
+}
+
+static uint32_t *find_solution(const solution_verifier *verifier, const uint16_t *by_piece, const uint64_t hash)
+{
+    // The slot of the solution, or the empty slot where it would go
+    uint32_t pieces = verifier->tables->header->pieces;
+    uint64_t i = hash & verifier->size_mask;
+    while (verifier->slots[i] != 0)
+    {
+        if (memcmp(verifier->seen + (size_t)(verifier->slots[i] - 1) * pieces, by_piece, sizeof(uint16_t) * pieces) == 0)
+            break;
+        i = (i + 1) & verifier->size_mask;
+    }
+    return verifier->slots + i;
+}
+
+static bool grow_solutions(solution_verifier *verifier)
+{
+    uint32_t pieces = verifier->tables->header->pieces;
+    uint64_t capacity = verifier->seen_capacity * 2;
+    uint16_t *seen = (uint16_t *)realloc(verifier->seen, sizeof(uint16_t) * pieces * capacity);
+    uint32_t *slots = (uint32_t *)calloc(2 * capacity, sizeof(uint32_t));
+    if (seen != NULL)
+        verifier->seen = seen;
+    if (seen == NULL || slots == NULL || capacity > UINT32_MAX)
+    {
+        free(slots);
+        return false;
+    }
+
+    free(verifier->slots);
+    verifier->slots = slots;
+    verifier->size_mask = 2 * capacity - 1;
+    verifier->seen_capacity = capacity;
+    for (uint64_t s = 0; s < verifier->seen_count; s++)
+    {
+        const uint16_t *by_piece = verifier->seen + (size_t)s * pieces;
+        *find_solution(verifier, by_piece, solution_hash(by_piece, pieces)) = s + 1;
+    }
+    return true;
+}
+
+// Whether the solution was met before, it is remembered otherwise
+static bool seen_solution(solution_verifier *verifier, const uint16_t *by_piece)
+{
+    uint32_t pieces = verifier->tables->header->pieces;
+    uint64_t hash = solution_hash(by_piece, pieces);
+    uint32_t *slot = find_solution(verifier, by_piece, hash);
+    if (*slot != 0)
+        return true;
+
+    // Past the memory available, later duplicates of the new solutions aren't found
+    if (verifier->seen_count == verifier->seen_capacity)
+    {
+        if (!grow_solutions(verifier))
+            return false;
+        slot = find_solution(verifier, by_piece, hash);
+    }
+    memcpy(verifier->seen + (size_t)verifier->seen_count * pieces, by_piece, sizeof(uint16_t) * pieces);
+    *slot = ++verifier->seen_count;
+    return false;
+}
+
+//-------------------------Checks-------------------------
+
+static verify_status record(solution_verifier *verifier, const verify_status status)
+{
+    verifier->checked++;
+    verifier->counts[status]++;
+    return status;
+}
+
+verify_status verify_placements(solution_verifier *verifier, const uint16_t *placements, const int count)
+{
+    const tables_header *header = verifier->tables->header;
+    uint16_t by_piece[MAX_PIECES];
+    uint32_t used = 0;
+    uint64_t covered = 0;
+
+    if (count != (int)header->pieces)
+        return record(verifier, VERIFY_PIECES);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (placements[i] >= header->placements)
+            return record(verifier, VERIFY_UNKNOWN);
+        const placement *chosen = verifier->tables->placements + placements[i];
+        if (used & (1u << chosen->piece))
+            return record(verifier, VERIFY_PIECES);
+        if (covered & chosen->mask)
+            return record(verifier, VERIFY_OVERLAP);
+        if (verifier->board & chosen->mask)
+            return record(verifier, VERIFY_DATE);
+        used |= 1u << chosen->piece;
+        covered |= chosen->mask;
+        by_piece[chosen->piece] = placements[i];
+    }
+
+    // Placements are kept off the blocked cells by the tables, the date's cells are the rest of board
+    if (used != verifier->all_pieces)
+        return record(verifier, VERIFY_PIECES);
+    if ((covered | verifier->board) != ~0ULL)
+        return record(verifier, VERIFY_UNCOVERED);
+    if (seen_solution(verifier, by_piece))
+        return record(verifier, VERIFY_DUPLICATE);
+    return record(verifier, VERIFY_VALID);
+}
+
+verify_status verify_grid(solution_verifier *verifier, const char *cells, const int length)
+{
+    const tables_header *header = verifier->tables->header;
+    uint64_t piece_cells[MAX_PIECES] = {0};
+    uint16_t placements[MAX_PIECES];
+    int count = 0;
+
+    if (length != (int)(header->width * header->height))
+        return record(verifier, VERIFY_UNKNOWN);
+
+    for (uint32_t y = 0; y < header->height; y++)
+        for (uint32_t x = 0; x < header->width; x++)
+        {
+            char label = *cells++;
+            int piece = label >= '0' && label <= '9' ? label - '0' : label >= 'A' && label <= 'Z' ? label - 'A' + 10 : -1;
+            if (piece >= (int)header->pieces || (piece < 0 && label != '.' && label != '#'))
+                return record(verifier, VERIFY_UNKNOWN);
+            if (piece >= 0)
+                piece_cells[piece] |= 1ULL << CELL(x, y);
+        }
+
+    // Every piece's cells are looked up among its placements, the placements are then checked
+    for (uint32_t piece = 0; piece < header->pieces; piece++)
+    {
+        if (piece_cells[piece] == 0)
+            continue;
+        verify_entry key = {piece_cells[piece], 0};
+        const verify_entry *found = (const verify_entry *)bsearch(&key, verifier->sorted + header->piece_placements[piece],
+                                                                  header->piece_placements[piece + 1] - header->piece_placements[piece],
+                                                                  sizeof(verify_entry), compare_entries);
+        if (found == NULL)
+            return record(verifier, VERIFY_SHAPE);
+        placements[count++] = found->placement;
+    }
+    return verify_placements(verifier, placements, count);
+}
@@ -0,0 +1,61 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tables.h"
+
+typedef enum verify_status
+{
+    VERIFY_VALID,
+    VERIFY_UNKNOWN,   // A placement index out of the tables, or a grid which isn't a board
+    VERIFY_SHAPE,     // A grid piece whose cells aren't a variant of it
+    VERIFY_PIECES,    // A piece missing or used more than once
+    VERIFY_OVERLAP,   // Two pieces on the same cell
+    VERIFY_DATE,      // A piece on a cell of the date
+    VERIFY_UNCOVERED, // A free cell left uncovered
+    VERIFY_DUPLICATE, // The same pieces at the same places as an earlier solution
+    VERIFY_STATUSES
+} verify_status;
+
+typedef struct verify_entry
+{
+    uint64_t mask;
+    uint16_t placement;
+} verify_entry;
+
+// Checks solutions of one date independently of the engine which found them, with a few mask
+// operations per piece
+typedef struct solution_verifier
+{
+    const puzzle_tables *tables;
+    uint64_t board;
+    uint32_t all_pieces;
+
+    // The placements of every piece sorted by mask, to find the pieces of a grid
+    verify_entry *sorted;
+
+    // Solutions met, as their placements by piece, and an open-addressing table of their indexes
+    // plus one, 0 for an empty slot
+    uint16_t *seen;
+    uint64_t seen_count, seen_capacity;
+    uint32_t *slots;
+    uint64_t size_mask;
+
+    uint64_t checked, counts[VERIFY_STATUSES];
+} solution_verifier;
+
+bool verify_init(solution_verifier *verifier, const puzzle_tables *tables, const uint64_t board);
+void verify_free(solution_verifier *verifier);
+const char *verify_status_name(const verify_status status);
+
+// count placement indexes, in any order of the pieces
+verify_status verify_placements(solution_verifier *verifier, const uint16_t *placements, const int count);
+
+// The labels of the board's cells row by row without newlines, length of them : the piece's id
+// ('0'-'9' then 'A'-'Z') on a covered cell, '.' or '#' on an uncovered one. A grid which isn't
+// width by height cells is unknown.
+verify_status verify_grid(solution_verifier *verifier, const char *cells, const int length);
+
+#endif
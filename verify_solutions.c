@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <getopt.h>
+
+#include "tables.h"
+#include "profile.h"
+#include "output.h"
+#include "verify.h"
+
+// Solutions read at once from a binary stream
+#define VERIFY_BATCH 65536
+
+// Command line
+void usage();
+double now_seconds();
+
+// Reading
+bool verify_binary(FILE *input, solution_verifier *verifier, const bool quiet);
+bool verify_grids(FILE *input, solution_verifier *verifier, const bool quiet);
+void report(const solution_verifier *verifier, const verify_status status, const bool quiet);
+
+void usage()
+{
+    fprintf(stderr, "Usage: ./verify [options] month day week_day [FILE]\n"
+                    "  -p, --puzzle FILE  puzzle definition or compiled puzzle\n"
+                    "  -q, --quiet        only print the totals\n"
+                    "Checks the solutions of FILE (or stdin), written by ./solver --format binary or grid\n");
+    exit(1);
+}
+
+double now_seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *puzzle_path = NULL;
+    bool quiet = false;
+
+    static const struct option long_options[] = {
+        {"puzzle", required_argument, NULL, 'p'},
+        {"quiet", no_argument, NULL, 'q'},
+        {NULL, 0, NULL, 0}};
+
+    int option;
+    while ((option = getopt_long(argc, argv, "p:q", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 'p':
+            puzzle_path = optarg;
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (argc - optind < 3)
+        usage();
+
+    puzzle_tables *tables = puzzle_path != NULL ? tables_load(puzzle_path) : tables_default();
+    if (tables == NULL)
+        exit(1);
+    tables = profile_apply(tables);
+    if (!tables_check_dates(tables))
+        exit(1);
+
+    int targets[3] = {atoi(argv[optind]), atoi(argv[optind + 1]), atoi(argv[optind + 2])};
+    uint64_t board;
+    if (!tables_date_board(tables, targets, &board))
+    {
+        fprintf(stderr, "Error : %d %d %d isn't a date of this puzzle\n", targets[0], targets[1], targets[2]);
+        exit(1);
+    }
+
+    FILE *input = stdin;
+    if (argc - optind > 3 && strcmp(argv[optind + 3], "-") != 0)
+    {
+        input = fopen(argv[optind + 3], "rb");
+        if (input == NULL)
+        {
+            fprintf(stderr, "Error : cannot open %s\n", argv[optind + 3]);
+            exit(1);
+        }
+    }
+
+    solution_verifier verifier;
+    if (!verify_init(&verifier, tables, board))
+        exit(1);
+
+    // Binary streams start with their magic, anything else is read as grids
+    double start = now_seconds();
+    int first = getc(input);
+    if (first != EOF)
+        ungetc(first, input);
+    bool read = first == OUTPUT_MAGIC[0] ? verify_binary(input, &verifier, quiet) : verify_grids(input, &verifier, quiet);
+    double seconds = now_seconds() - start;
+
+    uint64_t invalid = verifier.checked - verifier.counts[VERIFY_VALID];
+    printf("%llu solutions, %llu valid, %llu invalid\n", (unsigned long long)verifier.checked,
+           (unsigned long long)verifier.counts[VERIFY_VALID], (unsigned long long)invalid);
+    for (int s = VERIFY_VALID + 1; s < VERIFY_STATUSES; s++)
+        if (verifier.counts[s] > 0)
+            printf("  %s : %llu\n", verify_status_name((verify_status)s), (unsigned long long)verifier.counts[s]);
+    fprintf(stderr, "Checked in %.3f s, %.0f solutions/s\n", seconds, seconds > 0 ? verifier.checked / seconds : 0);
+
+    if (input != stdin)
+        fclose(input);
+    verify_free(&verifier);
+    tables_free(tables);
+    return read && invalid == 0 ? 0 : 1;
+}
+
+//-------------------------Reading-------------------------
+
+void report(const solution_verifier *verifier, const verify_status status, const bool quiet)
+{
+    if (status != VERIFY_VALID && !quiet)
+        printf("solution %llu : %s\n", (unsigned long long)verifier->checked, verify_status_name(status));
+}
+
+bool verify_binary(FILE *input, solution_verifier *verifier, const bool quiet)
+{
+    const tables_header *header = verifier->tables->header;
+
+    // Placement indexes only mean something for the tables they were written with
+    uint8_t start[16];
+    if (fread(start, 1, sizeof(start), input) != sizeof(start) || memcmp(start, OUTPUT_MAGIC, 4) != 0)
+    {
+        fprintf(stderr, "Error : the solutions don't start with a binary header\n");
+        return false;
+    }
+    uint32_t pieces = 0;
+    uint64_t hash = 0;
+    for (int i = 0; i < 4; i++)
+        pieces |= (uint32_t)start[4 + i] << (8 * i);
+    for (int i = 0; i < 8; i++)
+        hash |= (uint64_t)start[8 + i] << (8 * i);
+    if (pieces != header->pieces || hash != header->hash)
+    {
+        fprintf(stderr, "Error : the solutions were written for another puzzle or piece order\n");
+        return false;
+    }
+
+    size_t record = 2 * pieces;
+    uint8_t *buffer = (uint8_t *)malloc(record * VERIFY_BATCH);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "Error : cannot allocate the input buffer\n");
+        return false;
+    }
+
+    uint16_t placements[MAX_PIECES];
+    size_t length;
+    bool complete = true;
+    while ((length = fread(buffer, 1, record * VERIFY_BATCH, input)) > 0)
+    {
+        for (size_t offset = 0; offset + record <= length; offset += record)
+        {
+            for (uint32_t i = 0; i < pieces; i++)
+                placements[i] = buffer[offset + 2 * i] | buffer[offset + 2 * i + 1] << 8;
+            report(verifier, verify_placements(verifier, placements, pieces), quiet);
+        }
+        if (length % record != 0)
+        {
+            fprintf(stderr, "Error : the last solution is truncated\n");
+            complete = false;
+            break;
+        }
+    }
+
+    free(buffer);
+    return complete;
+}
+
+bool verify_grids(FILE *input, solution_verifier *verifier, const bool quiet)
+{
+    const tables_header *header = verifier->tables->header;
+
+    // Boards are separated by blank lines
+    char cells[64];
+    uint32_t rows = 0;
+    bool malformed = false;
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    do
+    {
+        length = getline(&line, &capacity, input);
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+            line[--length] = '\0';
+
+        if (length > 0)
+        {
+            if (rows < header->height && (uint32_t)length == header->width)
+                memcpy(cells + rows * header->width, line, header->width);
+            else
+                malformed = true;
+            rows++;
+        }
+        else if (rows > 0)
+        {
+            report(verifier, verify_grid(verifier, cells, malformed ? 0 : rows * header->width), quiet);
+            rows = 0;
+            malformed = false;
+        }
+    } while (length >= 0);
+
+    free(line);
+    return true;
+}